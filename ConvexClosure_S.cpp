@@ -12,8 +12,11 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 #include <cstdint>
 #include <algorithm>
+#include <chrono>
 #include <numeric>
 #include <string>
+#include <utility>
+#include <vector>
 
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
@@ -28,6 +31,10 @@ using byte = int8_t;
 #include "exedit_memory.hpp"
 #include "relative_path.hpp"
 #include "tiled_image.hpp"
+#include "calibration.hpp"
+#include "kernels.hpp"
+#include "render.hpp"
+#include "capture.hpp"
 
 using i16 = int16_t;
 using i32 = int32_t;
@@ -52,16 +59,16 @@ struct check_data {
 FILTER_INFO("凸包σ");
 
 // trackbars.
-constexpr char const* track_names[] = { "余白", "透明度", "内透明度", "αしきい値", "画像X", "画像Y" };
+constexpr char const* track_names[] = { "余白", "透明度", "内透明度", "αしきい値", "画像X", "画像Y", "ぼかし", "線幅", "結合距離", "角度", "簡略化", "距離", "凹み幅" };
 constexpr auto track_name_invalid = "----";
 constexpr int32_t
-	track_den[]      = {   1,   10,   10,   10,     1,     1 },
-	track_min[]      = {   0,    0,    0,    0, -4000, -4000 },
-	track_min_drag[] = {   0,    0,    0,    0, -1000, -1000 },
-	track_def[]      = {   0,    0,    0,  500,     0,     0 },
-	track_max_drag[] = { 500, 1000, 1000, 1000, +1000, +1000 },
-	track_max[]	     = { 500, 1000, 1000, 1000, +4000, +4000 };
-constexpr int track_link[] = { 0, 0, 0, 0, 1, -1, };
+	track_den[]      = {   1,   10,   10,   10,     1,     1,   1,   1,   1,    10,  10,   1,    1 },
+	track_min[]      = {   0,    0,    0,    0, -4000, -4000,   0,   0,   0, -3600,   0,   0,    0 },
+	track_min_drag[] = {   0,    0,    0,    0, -1000, -1000,   0,   0,   0, -3600,   0,   0,    0 },
+	track_def[]      = {   0,    0,    0,  500,     0,     0,   0,   0,   0,     0,   0,   0,    0 },
+	track_max_drag[] = { 500, 1000, 1000, 1000, +1000, +1000, 100, 100,  50, +3600, 100, 100,  200 },
+	track_max[]	     = { 500, 1000, 1000, 1000, +4000, +4000, 500, 500, 100, +3600, 500, 500, 1000 };
+constexpr int track_link[] = { 0, 0, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, };
 
 namespace idx_track
 {
@@ -72,6 +79,13 @@ namespace idx_track
 		threshold,
 		img_x,
 		img_y,
+		feather,
+		stroke,
+		gap,
+		angle,
+		simplify,
+		field,
+		concave,
 	};
 	constexpr int count_entries = std::size(track_names);
 };
@@ -87,15 +101,24 @@ static_assert(
 
 // checks.
 constexpr char const* check_names[]
-	= { "アンチエイリアス", "背景色の設定", "パターン画像ファイル" };
+	= { "アンチエイリアス", "背景色の設定", "パターン画像ファイル", "編集中は簡易描画", "部分ごとに凸包",
+		"グラデーションなし\0線形グラデーション\0円形グラデーション\0線形 (凸包の範囲)\0円形 (凸包の範囲)\0", "終了色の設定", "角を丸める",
+		"凸包\0最小外接長方形\0最小外接円\0最小外接楕円\0" };
 constexpr int32_t
-	check_default[] = { check_data::checked, check_data::button, check_data::button };
+	check_default[] = { check_data::checked, check_data::button, check_data::button, check_data::unchecked, check_data::unchecked,
+		check_data::dropdown, check_data::button, check_data::unchecked, check_data::dropdown };
 namespace idx_check
 {
 	enum id : int {
 		antialias,
 		color,
 		file,
+		draft,
+		separate,
+		gradient,
+		color2,
+		round,
+		shape,
 	};
 	constexpr int count_entries = std::size(check_names);
 };
@@ -111,6 +134,8 @@ constexpr ExEdit::ExdataUse exdata_use[] =
 	{ .type = ExEdit::ExdataUse::Type::Binary, .size = 3, .name = "color" },
 	{ .type = ExEdit::ExdataUse::Type::Padding, .size = 1, .name = nullptr },
 	{ .type = ExEdit::ExdataUse::Type::String, .size = 256, .name = "file" },
+	{ .type = ExEdit::ExdataUse::Type::Binary, .size = 3, .name = "color2" },
+	{ .type = ExEdit::ExdataUse::Type::Padding, .size = 1, .name = nullptr },
 };
 namespace idx_data
 {
@@ -126,13 +151,15 @@ namespace idx_data
 	enum id : int {
 		color = _impl::idx("color"),
 		file = _impl::idx("file"),
+		color2 = _impl::idx("color2"),
 	};
-	constexpr int count_entries = 3;
+	constexpr int count_entries = 5;
 }
 //#pragma pack(push, 1)
 struct Exdata {
 	ExEdit::Exdata::ExdataColor color{ .r = 0, .g = 0, .b = 0 };
 	char file[exdata_use[idx_data::file].size]{};
+	ExEdit::Exdata::ExdataColor color2{ .r = 255, .g = 255, .b = 255 };
 };
 
 //#pragma pack(pop)
@@ -145,7 +172,12 @@ static_assert(sizeof(Exdata) == std::accumulate(
 BOOL func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip);
 BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl::EditHandle* editp, ExEdit::Filter* efp);
 int32_t func_window_init(HINSTANCE hinstance, HWND hwnd, int y, int base_id, int sw_param, ExEdit::Filter* efp);
-static inline BOOL func_init(ExEdit::Filter* efp) { exedit.init(efp->exedit_fp); return TRUE; }
+static inline BOOL func_init(ExEdit::Filter* efp)
+{
+	exedit.init(efp->exedit_fp);
+	kernels::init();
+	return TRUE;
+}
 
 
 static inline constinit ExEdit::Filter filter = {
@@ -193,12 +225,14 @@ static inline void update_extendedfilter_wnd(ExEdit::Filter* efp)
 	auto* exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
 
 	// whether the background pattern image is specified, or single color.
-	wchar_t col_fmt[size_col_fmt] = L"";
+	wchar_t col_fmt[size_col_fmt] = L"", col2_fmt[size_col_fmt] = L"";
 	auto file = "", img_x = track_names[idx_track::img_x], img_y = track_names[idx_track::img_y];
 	if (exdata->file[0] == '\0') {
-		// single color.
+		// single color, or gradient.
 		::swprintf_s(col_fmt, color_format,
 			exdata->color.r, exdata->color.g, exdata->color.b);
+		::swprintf_s(col2_fmt, color_format,
+			exdata->color2.r, exdata->color2.g, exdata->color2.b);
 		img_x = img_y = track_name_invalid;
 	}
 	else {
@@ -213,6 +247,7 @@ static inline void update_extendedfilter_wnd(ExEdit::Filter* efp)
 
 	// set label text next to the buttons.
 	::SetWindowTextW(efp->exfunc->get_hwnd(efp->processing, 5, idx_check::color), col_fmt);
+	::SetWindowTextW(efp->exfunc->get_hwnd(efp->processing, 5, idx_check::color2), col2_fmt);
 	::SetWindowTextA(efp->exfunc->get_hwnd(efp->processing, 5, idx_check::file), file);
 }
 
@@ -229,12 +264,13 @@ BOOL func_WndProc(HWND, UINT message, WPARAM wparam, LPARAM lparam, AviUtl::Edit
 	case EXTENDEDFILTER_PUSH_BUTTON:
 		switch (chk) {
 		case idx_check::color:
+		case idx_check::color2:
 		{
 			efp->exfunc->set_undo(efp->processing, 0);
 			char const heading = std::exchange(exdata->file[0], '\0');
-			if (efp->exfunc->x6c(efp, &exdata->color, 0x002)) { // color_dialog
+			if (efp->exfunc->x6c(efp, chk == idx_check::color ? &exdata->color : &exdata->color2, 0x002)) { // color_dialog
 				std::memset(exdata->file, 0, sizeof(exdata->file));
-				exedit.update_any_exdata(efp->processing, exdata_use[idx_data::color].name);
+				exedit.update_any_exdata(efp->processing, exdata_use[chk == idx_check::color ? idx_data::color : idx_data::color2].name);
 				exedit.update_any_exdata(efp->processing, exdata_use[idx_data::file].name);
 
 				update_extendedfilter_wnd(efp);
@@ -293,609 +329,18 @@ int32_t func_window_init(HINSTANCE hinstance, HWND hwnd, int y, int base_id, int
 ////////////////////////////////
 // フィルタ処理．
 ////////////////////////////////
-constexpr int log2_max_alpha = 12, max_alpha = 1 << log2_max_alpha;
-
-template<size_t src_step, size_t dst_step, bool antialias, bool handle_corner>
-bool calc_convex_closure(i16 const* src_buf, int obj_w, int obj_h, size_t src_stride,
-	i16 threshold, i16* dst_buf, size_t dst_stride, int extend, void* heap)
-{
-	// threshold is used as: alpha > threshold / alpha <= threshold.
-
-	// left/right edges of non-trasparent pixels on each line.
-	int const dst_w = obj_w + 2 * extend, dst_h = obj_h + 2 * extend;
-	auto const
-		heap1 = reinterpret_cast<int*>(heap),
-		heap2 = heap1 + 2 * (dst_h + 1),
-		heap3 = heap2 + 2 * (dst_h + 1),
-		heap4 = heap3 + 2 * (dst_h + 1);
-
-	// vertices of the desired convex closure,
-	// which is a polygon as the number of pixels is finite.
-	struct key_points {
-		int top, btm;
-		int* x_map;
-		int* key_pts;
-		int count;
-		constexpr auto peek(int i) const {
-			return std::pair{ key_pts[2 * (count - i)], key_pts[2 * (count - i) + 1] };
-		}
-		constexpr void push(int x, int y) {
-			key_pts[2 * count] = x; key_pts[2 * count + 1] = y;
-			count++;
-		}
-		constexpr void pop() { count--; }
-		constexpr key_points(int top, int btm, int* x_map, int* key_pts)
-			: top{ top }, btm{ btm }, x_map{ x_map }, key_pts{ key_pts }, count{ 1 } {
-			key_pts[0] = x_map[top]; key_pts[1] = top;
-		}
-	#pragma warning ( suppress : 26495 ) // member variables intentionally left uninitialized.
-		constexpr key_points() {}
-	};
-	key_points LT, LB, RT, RB;
-
-	// first, traverse pixels for rough bounding.
-	{
-		auto const heap1r = heap1 + obj_h;
-		struct bound {
-			int top, btm;
-			int l_min, l_min_top, l_min_btm;
-			int r_max, r_max_top, r_max_btm;
-		};
-		auto bounds = multi_thread(obj_h, [&](int thread_id, int thread_num) -> bound {
-			int top = obj_h, btm = -1,
-				l_min = obj_w, l_min_top = obj_h, l_min_btm = -1,
-				r_max = -1, r_max_top = obj_h, r_max_btm = -1;
-			for (int y = thread_id; y < obj_h; y += thread_num) {
-				int x = 0;
-				for (auto line = src_buf + y * src_stride;
-					x < obj_w; x++, line += src_step) {
-					if (*line > threshold) goto black_found;
-				}
-				heap1[y] = obj_w; heap1r[y] = 0;
-				continue;
-
-			black_found:
-				if (top > y) top = y;
-				btm = y;
-
-				heap1[y] = x;
-				if (x <= l_min) {
-					if (x < l_min) {
-						l_min = x;
-						l_min_top = y;
-					}
-					l_min_btm = y;
-				}
-
-				x = obj_w - 1;
-				for (auto line = src_buf + x * src_step + y * src_stride;
-					; x--, line -= src_step) {
-					if (*line > threshold) break;
-				}
-				heap1r[y] = ~x; // "flip" so subsequent comparison will simplify.
-				if (x >= r_max) {
-					if (x > r_max) {
-						r_max = x;
-						r_max_top = y;
-					}
-					r_max_btm = y;
-				}
-			}
-
-			return {
-				top, btm,
-				l_min, l_min_top, l_min_btm,
-				r_max, r_max_top, r_max_btm,
-			};
-		});
-
-		// combine the found boundings.
-		bound bd{
-			obj_h, -1,
-			obj_w, obj_h, -1,
-			-1, obj_h, -1,
-		};
-		for (auto& bd_i : bounds) {
-			if (bd_i.top > bd_i.btm) continue;
-
-			bd.top = std::min(bd.top, bd_i.top);
-			bd.btm = std::max(bd.btm, bd_i.btm);
-
-			if (bd.l_min == bd_i.l_min) {
-				bd.l_min_top = std::min(bd.l_min_top, bd_i.l_min_top);
-				bd.l_min_btm = std::max(bd.l_min_btm, bd_i.l_min_btm);
-			}
-			else if (bd.l_min > bd_i.l_min) {
-				bd.l_min = bd_i.l_min;
-				bd.l_min_top = bd_i.l_min_top;
-				bd.l_min_btm = bd_i.l_min_btm;
-			}
-
-			if (bd.r_max == bd_i.r_max) {
-				bd.r_max_top = std::min(bd.r_max_top, bd_i.r_max_top);
-				bd.r_max_btm = std::max(bd.r_max_btm, bd_i.r_max_btm);
-			}
-			else if (bd.r_max < bd_i.r_max) {
-				bd.r_max = bd_i.r_max;
-				bd.r_max_top = bd_i.r_max_top;
-				bd.r_max_btm = bd_i.r_max_btm;
-			}
-		}
+using render::max_alpha;
 
-		// found to be empty.
-		if (bd.top > bd.btm) return false;
-
-		// summary.
-		LT = { bd.top, bd.l_min_top, heap1,  heap3 };
-		LB = { bd.l_min_btm, bd.btm, heap1,  heap3 + 2 * (bd.l_min_top - bd.top + 1) };
-		RT = { bd.top, bd.r_max_top, heap1r, heap4 };
-		RB = { bd.r_max_btm, bd.btm, heap1r, heap4 + 2 * (bd.r_max_top - bd.top + 1) };
-	}
-
-	// identify "key points" by Graham scan (https://en.wikipedia.org/wiki/Graham_scan).
-	multi_thread(2 * (LB.btm - LT.top + 1) < (1 << 6), [&](int thread_id, int thread_num) {
-		// parallel loop up to four threads.
-		for (int i = thread_id; i < 4; i += thread_num) {
-			auto const quad = [&]{
-				switch (i) {
-				case 0: return &LT;
-				case 1: return &LB;
-				case 2: return &RT;
-				case 3: return &RB;
-				default: std::unreachable();
-				}
-			}();
-
-			if (int const y_btm = quad->btm;
-				quad->top < y_btm) {
-				int const x_btm = quad->x_map[y_btm];
-
-				auto [x1, y1] = quad->peek(1);
-				int diff_x = x_btm - x1, diff_y = y_btm - y1, cmp_base = x1 * diff_y;
-				int y = y1 + 1; int const* x_map = quad->x_map + y;
-				for (; y < y_btm; y++, x_map++) {
-					int const x = *x_map;
-					cmp_base += diff_x;
-					if (cmp_base > x * diff_y) {
-						while (quad->count > 1) {
-							auto const [x0, y0] = quad->peek(2);
-							int const dx1 = x1 - x0, dy1 = y1 - y0,
-								dx = x - x1, dy = y - y1;
-							if (dx * dy1 > dx1 * dy) break;
-							quad->pop();
-							x1 = x0; y1 = y0;
-						}
-						quad->push(x, y);
-						x1 = x; y1 = y;
-						diff_x = x_btm - x; diff_y = y_btm - y; cmp_base = x * diff_y;
-					}
-				}
-				quad->push(x_btm, y_btm);
-			}
-		}
-	});
-
-	// extend the polygon defined by those key points.
-	if (extend > 0) {
-		LT.x_map = heap1; LB.x_map = heap1 + 2 * LT.count;
-		RT.x_map = heap2; RB.x_map = heap2 + 2 * RT.count;
-
-		// suppose the two lines (y-y1)/dy_i=(x-x1)/dx_i (i=1,2) that pass the point (x1, y1).
-		// move them by `length` pixels to the direction orthogonal to themselves.
-		// this lambda calculates the crossing point of the moved lines with some boundary handlings.
-		constexpr auto extend_point = [](int length, int x1, int y1, int dx1, int dy1, int dx2, int dy2,
-			int bound, bool is_head) {
-			auto const
-				l1 = std::sqrtf(static_cast<float>(dx1 * dx1 + dy1 * dy1)),
-				l2 = std::sqrtf(static_cast<float>(dx2 * dx2 + dy2 * dy2));
-			int X1, Y1;
-			if (handle_corner && (dy1 < 0 || dy2 < 0 || dx1 * dx2 < 0)) {
-				// in cases where the signatures of dy1/dx1 and dy2/dx2 do not match.
-				auto const t = dx1 * dy2 - dx2 * dy1;
-				auto ofs_x = -(dx1 * l2 - dx2 * l1) * length / t,
-					ofs_y = -(dy1 * l2 - dy2 * l1) * length / t;
-
-				if (dy1 < 0 || dy2 < 0) {
-					Y1 = y1 + static_cast<int>(std::round(ofs_y));
-					if (is_head ? Y1 < bound : Y1 > bound) {
-						// y-coordinate exceeds the bound.
-						Y1 = bound;
-
-						// move the point along the line to fit within the boundary.
-						// is_head chooses which line to go along with.
-						ofs_y -= bound - y1;
-						ofs_x -= is_head ? ofs_y * dx2 / dy2 : ofs_y * dx1 / dy1;
-					}
-					X1 = x1 + static_cast<int>(std::round(ofs_x));
-				}
-				else {
-					X1 = x1 + static_cast<int>(std::round(ofs_x));
-					if (X1 < bound) {
-						// x-coordinate exceeds the bound.
-						X1 = bound;
-
-						// move the point along the line to fit within the boundary.
-						// is_head chooses which line to go along with.
-						ofs_x -= bound - x1;
-						ofs_y -= is_head ? ofs_x * dy2 / dx2 : ofs_x * dy1 / dx1;
-					}
-					Y1 = y1 + static_cast<int>(std::round(ofs_y));
-				}
-			}
-			else {
-				// dy1, dy2 >= 0 and dx1 * dx2 >= 0.
-				auto const s = (dx1 * dy2 + dx2 * dy1) * length;
-				auto ofs_x = -s / (dx2 * l1 + dx1 * l2), ofs_y = s / (dy2 * l1 + dy1 * l2);
-
-				// they won't go beyond the boundary.
-				X1 = x1 + static_cast<int>(std::round(ofs_x));
-				Y1 = y1 + static_cast<int>(std::round(ofs_y));
-			}
-
-			return std::pair{ X1, Y1 };
-		};
-		multi_thread(LT.count + LB.count + RT.count + RB.count < (1 << 6), [&](int thread_id, int thread_num) {
-			for (int i = thread_id; i < 4; i += thread_num) {
-				auto const [quad, ext1, ext2, bd1, bd2] = [&] {
-					switch (i) {
-					case 0: return std::tuple{ &LT, &RT, &LB, -extend, -extend };
-					case 1: return std::tuple{ &LB, &LT, &RB, -extend, obj_h + extend - 1 };
-					case 2: return std::tuple{ &RT, &LT, &RB, -extend, ~(obj_w + extend - 1) };
-					case 3: return std::tuple{ &RB, &RT, &LB, ~(obj_w + extend - 1), obj_h + extend - 1 };
-					default: std::unreachable();
-					}
-				}();
-
-				if (quad->count > 1) {
-					int const* pts = quad->key_pts;
-					int x1 = pts[0], y1 = pts[1]; pts += 2;
-
-					int dx1, dy1;
-					if (i % 2 == 0) {
-						if (handle_corner && ext1->count > 1 && x1 == ~ext1->key_pts[0]) {
-							dx1 = x1 - (~ext1->key_pts[2]);
-							dy1 = y1 - ext1->key_pts[3];
-						}
-						else { dx1 = -1; dy1 = 0; }
-					}
-					else {
-						if (handle_corner && ext1->count > 1 && y1 == ext1->btm) {
-							dx1 = x1 - ext1->key_pts[2 * ext1->count - 4];
-							dy1 = y1 - ext1->key_pts[2 * ext1->count - 3];
-						}
-						else { dx1 = 0; dy1 = 1; }
-					}
-					int* dst = quad->x_map;
-					for (int j = quad->count - 1; --j >= 0; pts += 2, dst += 2) {
-						int const x2 = pts[0], y2 = pts[1],
-							dx2 = x2 - x1, dy2 = y2 - y1;
-
-						std::tie(dst[0], dst[1]) = extend_point(extend, x1, y1, dx1, dy1, dx2, dy2, bd1, true);
-
-						x1 = x2; dx1 = dx2;
-						y1 = y2; dy1 = dy2;
-					}
-					{
-						int dx2, dy2;
-						if (i % 2 == 0) {
-							if (handle_corner && ext2->count > 1 && y1 == ext2->top) {
-								dx2 = ext2->key_pts[2] - x1;
-								dy2 = ext2->key_pts[3] - y1;
-							}
-							else { dx2 = 0; dy2 = 1; }
-						}
-						else {
-							if (handle_corner && ext2->count > 1 && x1 == ~ext2->key_pts[2 * ext2->count - 2]) {
-								dx2 = (~ext2->key_pts[2 * ext2->count - 4]) - x1;
-								dy2 = ext2->key_pts[2 * ext2->count - 3] - y1;
-							}
-							else { dx2 = 1; dy2 = 0; }
-						}
-
-						std::tie(dst[0], dst[1]) = extend_point(extend, x1, y1, dx1, dy1, dx2, dy2, bd2, false);
-					}
-				}
-				else {
-					quad->x_map[0] = quad->key_pts[0] - extend;
-					quad->x_map[1] = quad->key_pts[1] + (i % 2 == 0 ? -extend : extend);
-				}
-			}
-		});
-
-		for (auto quad : { &LT, &LB, &RT, &RB }) {
-			quad->key_pts = quad->x_map;
-			quad->top = quad->key_pts[1];
-			quad->btm = quad->key_pts[2 * quad->count - 1];
-		}
-		LT.x_map = LB.x_map = heap3;
-		RT.x_map = RB.x_map = heap4;
-	}
-	else {
-		// vertices dont' change. allocate the buffer for the next calculation.
-		LT.x_map = LB.x_map = heap1;
-		RT.x_map = RB.x_map = heap2;
-	}
-
-	// represents the area: d*y <= n*(x-1)+s, contained in the box 0 <= x,y <= 1.
-	// helps drawing antialiased lines.
-	struct pixel_walker {
-		// assumes all of these three are positive.
-		uint32_t slope_n, slope_d, state;
-		bool is_next_up() const { return state > slope_d; }
-		uint32_t move_to_top() {
-			auto q = (state - 1) / slope_d,
-				r = (state - 1) % slope_d;
-			state = r + 1;
-			return q;
-		}
-		bool adjust_fullness() {
-			if (state >= slope_n + slope_d) {
-				move_up();
-				return true;
-			}
-			return false;
-		}
-		void move_up() { state -= slope_d; }
-		void move_right() { state += slope_n; }
-		i16 fill_rate() const {
-			if (state >= slope_d) {
-				if (state >= slope_n) {
-					// 1 - 1/2 x (1-(s-n)/d) x (1-(s-d)/n) = 1 - (n+d-s)^2/(2*n*d).
-					auto const a = slope_n + slope_d - state;
-					return static_cast<i16>(max_alpha - (max_alpha * a * a) / (2 * slope_n * slope_d));
-				}
-				else {
-					// 1 - 1/2 x ((1-s/n)+(1-(s-d)/n)) = (s-d/2)/n.
-					return static_cast<i16>((max_alpha * (2 * state - slope_d)) / (2 * slope_n));
-				}
-			}
-			else {
-				if (state >= slope_n) {
-					// 1/2 x (s/d + (s-n)/d) = (s-n/2)/d.
-					return static_cast<i16>((max_alpha * (2 * state - slope_n)) / (2 * slope_d));
-				}
-				else {
-					// 1/2 x s/d x s/n.
-					return static_cast<i16>((max_alpha * (state * state)) / (2 * slope_n * slope_d));
-				}
-			}
-		}
+// views the pixels as those the kernels take.
+static_assert(sizeof(kernels::pixel) == sizeof(ExEdit::PixelYCA) && alignof(kernels::pixel) == alignof(ExEdit::PixelYCA));
+inline kernels::pixel* as_pixels(ExEdit::PixelYCA* p) { return reinterpret_cast<kernels::pixel*>(p); }
+inline kernels::pixel const* as_pixels(ExEdit::PixelYCA const* p) { return reinterpret_cast<kernels::pixel const*>(p); }
 
-		pixel_walker(uint32_t n, uint32_t d) : slope_n{ n }, slope_d{ d }, state{ n } {}
-		pixel_walker(int n, int d) : pixel_walker(static_cast<uint32_t>(n), static_cast<uint32_t>(d)) {}
-	};
-	// draw line segments surrounding those key points,
-	// and at the same time, rewrite left_map and right_map so
-	// they identify the range of the pixels to be filled opaque.
-	multi_thread(2 * (LB.btm + 1 - LT.top) < (1 << 6), [&](int thread_id, int thread_num) {
-		// parallel loop up to six threads.
-		for (int i = thread_id; i < 6; i += thread_num) {
-			switch (i) {
-			case 0:
-			{
-				// initial key point.
-				auto const* pts = LT.key_pts;
-				int x0 = pts[0] + extend, y0 = pts[1] + extend; pts += 2;
-				auto* x_map = LT.x_map + 2 * y0;
-				for (int j = LT.count - 1; --j >= 0; pts += 2) {
-					// find the next key point, and setup a state machine.
-					int const x1 = pts[0] + extend, y1 = pts[1] + extend;
-					pixel_walker pw{ x0 - x1, y1 - y0 };
-
-					// walk through pixels while drawing lines.
-					x0--;
-					if constexpr (antialias) {
-						for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
-							y0 < y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
-							x_map[1] = x0 + 1; // beginning of "black" pixels.
-							while (true) { // move horizontally.
-								*dst = pw.fill_rate();
-								if (!pw.is_next_up()) break;
-								pw.move_up(); x0--; dst -= dst_step;
-							}
-							x_map[0] = x0; // end of "white" pixels + 1.
-						}
-					}
-					else {
-						for (; y0 < y1; pw.move_right(), y0++, x_map += 2) {
-							if (pw.adjust_fullness()) x0--; // adjust corner case.
-
-							// end of "white" pixels + 1 / beginning of "black" pixels.
-							x_map[0] = x_map[1] = x0 + 1;
-
-							x0 -= pw.move_to_top(); // move horizontally.
-						}
-					}
-
-					// update the last key point.
-					y0 = y1; x0 = x1;
-				}
-				break;
-			}
-			case 1:
-			{
-				// initial key point
-				auto const* pts = LB.key_pts;
-				int x0 = pts[0] + extend, y0 = pts[1] + extend; pts += 2;
-				auto* x_map = LB.x_map + 2 * (y0 + 1);
-				for (int j = LB.count - 1; --j >= 0; pts += 2) {
-					// find the next key point, and setup a state machine.
-					int const x1 = pts[0] + extend, y1 = pts[1] + extend;
-					pixel_walker pw{ x1 - x0, y1 - y0 };
-
-					// walk through pixels while drawing lines.
-					y0++;
-					if constexpr (antialias) {
-						for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
-							y0 <= y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
-							x_map[0] = x0; // end of "white" pixels + 1.
-							while (true) { // move horizontally.
-								*dst = max_alpha - pw.fill_rate();
-								if (!pw.is_next_up()) break;
-								pw.move_up(); x0++; dst += dst_step;
-							}
-							x_map[1] = x0 + 1; // beginning of "black" pixels.
-						}
-					}
-					else {
-						for (; y0 <= y1; pw.move_right(), y0++, x_map += 2) {
-							x0 += pw.move_to_top(); // move horizontally.
-
-							// end of "white" pixels + 1 / beginning of "black" pixels.
-							x_map[0] = x_map[1] = x0 + 1;
-						}
-					}
-
-					// update the last key point.
-					y0 = y1; x0 = x1;
-				}
-				break;
-			}
-			case 2:
-			{
-				// initial key point.
-				auto const* pts = RT.key_pts;
-				int x0 = (~pts[0]) + extend, y0 = pts[1] + extend; pts += 2;
-				auto* x_map = RT.x_map + 2 * y0;
-				for (int j = RT.count - 1; --j >= 0; pts += 2) {
-					// find the next key point, and setup a state machine.
-					int const x1 = (~pts[0]) + extend, y1 = pts[1] + extend;
-					pixel_walker pw{ x1 - x0, y1 - y0 };
-
-					// walk through pixels while drawing lines.
-					x0++;
-					if constexpr (antialias) {
-						for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
-							y0 < y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
-							x_map[0] = x0; // end of "black" pixels + 1.
-							while (true) { // move horizontally.
-								*dst = pw.fill_rate();
-								if (!pw.is_next_up()) break;
-								pw.move_up(); x0++; dst += dst_step;
-							}
-							x_map[1] = x0 + 1; // beginning of "white" pixels.
-						}
-					}
-					else {
-						for (; y0 < y1; pw.move_right(), y0++, x_map += 2) {
-							if (pw.adjust_fullness()) x0++; // adjust corner case.
-
-							// beginning of "white" pixels / end of "black" pixels + 1.
-							x_map[0] = x_map[1] = x0;
-
-							x0 += pw.move_to_top(); // move horizontally.
-						}
-					}
-
-					// update the last key point.
-					y0 = y1; x0 = x1;
-				}
-				break;
-			}
-			case 3:
-			{
-				// initial key point
-				auto const* pts = RB.key_pts;
-				int x0 = (~pts[0]) + extend, y0 = pts[1] + extend; pts += 2;
-				auto* x_map = RB.x_map + 2 * (y0 + 1);
-				for (int j = RB.count - 1; --j >= 0; pts += 2) {
-					// find the next key point, and setup a state machine.
-					int const x1 = (~pts[0]) + extend, y1 = pts[1] + extend;
-					pixel_walker pw{ x0 - x1, y1 - y0 };
-
-					// walk through pixels while drawing lines.
-					y0++;
-					if constexpr (antialias) {
-						for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
-							y0 <= y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
-							x_map[1] = x0 + 1; // beginning of "white" pixels.
-							while (true) { // move horizontally.
-								*dst = max_alpha - pw.fill_rate();
-								if (!pw.is_next_up()) break;
-								pw.move_up(); x0--; dst -= dst_step;
-							}
-							x_map[0] = x0; // end of "black" pixels + 1.
-						}
-					}
-					else {
-						for (; y0 <= y1; pw.move_right(), y0++, x_map += 2) {
-							x0 -= pw.move_to_top(); // move horizontally.
-
-							// beginning of "white" pixels / end of "black" pixels + 1.
-							x_map[0] = x_map[1] = x0;
-						}
-					}
-
-					// update the last key point.
-					y0 = y1; x0 = x1;
-				}
-				break;
-			}
-			case 4:
-			{
-				// handle pixels between y_l_top and y_l_btm.
-				int const x12 = LB.key_pts[0] + extend;
-				auto* x_map = LT.x_map + 2 * (LT.btm + extend);
-				for (int j = LB.top - LT.btm + 1; --j >= 0; x_map += 2)
-					x_map[0] = x_map[1] = x12;
-				break;
-			}
-			case 5:
-			{
-				// handle pixels between y_r_top and y_r_btm.
-				int const x34 = (~RB.key_pts[0]) + 1 + extend;
-				auto* x_map = RT.x_map + 2 * (RT.btm + extend);
-				for (int j = RB.top - RT.btm + 1; --j >= 0; x_map += 2)
-					x_map[0] = x_map[1] = x34;
-				break;
-			}
-			}
-		}
-	});
-
-	// fill the rest of pixels.
-	LT.top += extend; RB.btm += extend;
-	multi_thread(dst_h, [&](int thread_id, int thread_num) {
-		for (int y = thread_id; y < dst_h; y += thread_num) {
-			i16* dst_y = dst_buf + y * dst_stride;
-			if (y < LT.top || y > RB.btm) {
-				for (int i = dst_w; --i >= 0; dst_y += dst_step) *dst_y = 0;
-			}
-			else {
-				auto const l = LT.x_map + 2 * y, r = RB.x_map + 2 * y;
-				int x1 = l[0], x2 = l[1], x3 = r[0], x4 = r[1];
-
-				// white on the left side.
-				for (int i = x1; --i >= 0; dst_y += dst_step) *dst_y = 0;
-
-				// black on the middle.
-				dst_y += (x2 - x1) * dst_step;
-				for (int i = x3 - x2; --i >= 0; dst_y += dst_step) *dst_y = max_alpha;
-
-				// white on the right side.
-				dst_y += (x4 - x3) * dst_step;
-				for (int i = dst_w - x4; --i >= 0; dst_y += dst_step) *dst_y = 0;
-			}
-		}
-	});
-
-	return true;
-}
-constexpr ExEdit::PixelYC fromRGB(uint8_t r, uint8_t g, uint8_t b) {
-	// ripped a piece of code from exedit/pixel.hpp.
-	auto r_ = (r << 6) + 18;
-	auto g_ = (g << 6) + 18;
-	auto b_ = (b << 6) + 18;
-	return {
-		static_cast<int16_t>(((r_* 4918)>>16)+((g_* 9655)>>16)+((b_* 1875)>>16)-3),
-		static_cast<int16_t>(((r_*-2775)>>16)+((g_*-5449)>>16)+((b_* 8224)>>16)+1),
-		static_cast<int16_t>(((r_* 8224)>>16)+((g_*-6887)>>16)+((b_*-1337)>>16)+1),
-	};
-}
 BOOL func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 {
 	int const src_w = efpip->obj_w, src_h = efpip->obj_h;
 	if (src_w <= 0 || src_h <= 0) return TRUE;
+	calibration::ensure();
 
 	constexpr int
 		den_extend		= track_den[idx_track::extend],
@@ -920,7 +365,35 @@ BOOL func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 
 		den_img_y		= track_den[idx_track::img_y],
 		min_img_y		= track_min[idx_track::img_y],
-		max_img_y		= track_max[idx_track::img_y];
+		max_img_y		= track_max[idx_track::img_y],
+
+		den_feather		= track_den[idx_track::feather],
+		min_feather		= track_min[idx_track::feather],
+		max_feather		= track_max[idx_track::feather],
+
+		den_stroke		= track_den[idx_track::stroke],
+		min_stroke		= track_min[idx_track::stroke],
+		max_stroke		= track_max[idx_track::stroke],
+
+		den_gap			= track_den[idx_track::gap],
+		min_gap			= track_min[idx_track::gap],
+		max_gap			= track_max[idx_track::gap],
+
+		den_angle		= track_den[idx_track::angle],
+		min_angle		= track_min[idx_track::angle],
+		max_angle		= track_max[idx_track::angle],
+
+		den_simplify	= track_den[idx_track::simplify],
+		min_simplify	= track_min[idx_track::simplify],
+		max_simplify	= track_max[idx_track::simplify],
+
+		den_field		= track_den[idx_track::field],
+		min_field		= track_min[idx_track::field],
+		max_field		= track_max[idx_track::field],
+
+		den_concave		= track_den[idx_track::concave],
+		min_concave		= track_min[idx_track::concave],
+		max_concave		= track_max[idx_track::concave];
 
 	int const
 		extend		= std::clamp(efp->track[idx_track::extend	], min_extend, std::min(max_extend,
@@ -929,167 +402,85 @@ BOOL func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		f_transp	= std::clamp(efp->track[idx_track::f_transp	], min_f_transp, max_f_transp),
 		threshold	= std::clamp(efp->track[idx_track::threshold], min_threshold, max_threshold),
 		img_x		= std::clamp(efp->track[idx_track::img_x	], min_img_x, max_img_x),
-		img_y		= std::clamp(efp->track[idx_track::img_y	], min_img_y, max_img_y);
-	bool const antialias = efp->check[idx_check::antialias] != check_data::unchecked;
+		img_y		= std::clamp(efp->track[idx_track::img_y	], min_img_y, max_img_y),
+		stroke		= std::clamp(efp->track[idx_track::stroke	], min_stroke, std::min(max_stroke,
+			(std::min(exedit.yca_max_w - efpip->obj_w, exedit.yca_max_h - efpip->obj_h) >> 1) - extend)),
+		// the outer half of the feather needs the room as well as the outline.
+		feather		= std::clamp(efp->track[idx_track::feather	], min_feather, std::min(max_feather,
+			2 * ((std::min(exedit.yca_max_w - efpip->obj_w, exedit.yca_max_h - efpip->obj_h) >> 1) - extend - stroke))),
+		gap			= std::clamp(efp->track[idx_track::gap		], min_gap, max_gap),
+		angle		= std::clamp(efp->track[idx_track::angle	], min_angle, max_angle),
+		simplify	= std::clamp(efp->track[idx_track::simplify	], min_simplify, max_simplify),
+		field		= std::clamp(efp->track[idx_track::field	], min_field, std::min(max_field,
+			(std::min(exedit.yca_max_w - efpip->obj_w, exedit.yca_max_h - efpip->obj_h) >> 1) - extend)),
+		concave		= std::clamp(efp->track[idx_track::concave	], min_concave, max_concave),
+		// the outline is drawn outside the polygon extended by `extend`, and the feather spreads
+		// by its half beyond, or the distance field spreads on both sides of it instead.
+		margin		= extend + (field > 0 ? field : stroke + (feather + 1) / 2);
+	// lighten the load while editing, but not when saving the video.
+	bool const draft = efp->check[idx_check::draft] != check_data::unchecked &&
+		!exedit.fp->exfunc->is_saving(*exedit.editp);
+	bool const antialias = !draft && efp->check[idx_check::antialias] != check_data::unchecked,
+		separate = efp->check[idx_check::separate] != check_data::unchecked;
 	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
 
 	int const
 		alpha = std::clamp(max_alpha * (max_transp - transp) / max_transp, 0, max_alpha),
 		f_alpha = std::clamp(max_alpha * (max_f_transp - f_transp) / max_f_transp, 0, max_alpha);
 
-	int const dst_w = efpip->obj_w + 2 * extend, dst_h = efpip->obj_h + 2 * extend;
-
-	// handle trivial cases.
-	if (alpha <= 0 ||
-		!(antialias ? calc_convex_closure<4, 4, true, true> : calc_convex_closure<4, 4, false, true>)
-		(&efpip->obj_edit->a, efpip->obj_w, efpip->obj_h, 4 * efpip->obj_line,
-			(threshold * (max_alpha - 1)) / max_threshold,
-			&efpip->obj_temp->a, 4 * efpip->obj_line, extend,
-			*exedit.memory_ptr)) {
-		if (extend > 0) {
-			auto do_work = [&]<bool handle_alpha>{
-				multi_thread(efpip->obj_h, [&, src_w = efpip->obj_w](int thread_id, int thread_num) {
-					for (int y = thread_id; y < dst_h; y += thread_num) {
-						auto* dst_y = &efpip->obj_temp[y * efpip->obj_line];
-						if (y < extend || y >= dst_h - extend) {
-							for (int x = dst_w; --x >= 0; dst_y++) dst_y->a = 0;
-						}
-						else {
-							for (int x = extend; --x >= 0; dst_y++) dst_y->a = 0;
-							auto const* src_y = &efpip->obj_edit[(y - extend) * efpip->obj_line];
-							if constexpr (handle_alpha) {
-								for (int x = src_w; --x >= 0; dst_y++, src_y++) {
-									*dst_y = *src_y;
-									dst_y->a = (f_alpha * dst_y->a) >> log2_max_alpha;
-								}
-							}
-							else {
-								std::memcpy(dst_y, src_y, sizeof(*dst_y) * src_w);
-								dst_y += src_w;
-							}
-							for (int x = extend; --x >= 0; dst_y++) dst_y->a = 0;
-						}
-					}
-				});
-			};
-			if (f_alpha < max_alpha) do_work.operator()<true>(); else do_work.operator()<false>();
-			std::swap(efpip->obj_edit, efpip->obj_temp);
-			efpip->obj_w = dst_w; efpip->obj_h = dst_h;
-		}
-		else if (f_alpha < max_alpha) {
-			multi_thread(dst_h, [&](int thread_id, int thread_num) {
-				int y0 = dst_h * thread_id / thread_num, y1 = efpip->obj_h * (thread_id + 1) / thread_num;
-				i16* dst_y = &efpip->obj_edit[y0 * efpip->obj_line].a;
-				for (int y = y1 - y0; --y >= 0; dst_y += 4 * efpip->obj_line) {
-					i16* dst_x = dst_y;
-					for (int x = dst_w; --x >= 0; dst_x += 4)
-						*dst_x = (f_alpha * (*dst_x)) >> log2_max_alpha;
-				}
+	// find the shape and draw it, with the pattern image loaded into *exedit.memory_ptr if specified.
+	tiled_image img{ alpha > 0 ? relative_path::absolute{exdata->file}.abs_path.c_str() : nullptr,
+		img_x, img_y, margin, efpip->obj_line, efp, *exedit.memory_ptr };
+	render::pattern const pat = img ?
+		render::pattern{ as_pixels(img.buff), img.w, img.h, img.ox, img.oy, img.line } : render::pattern{};
+	render::params const p{
+		.extend = extend, .stroke = stroke, .feather = feather, .gap = gap,
+		.alpha = alpha, .f_alpha = f_alpha,
+		.threshold = static_cast<i16>((threshold * (max_alpha - 1)) / max_threshold),
+		.draft = draft, .antialias = antialias, .separate = separate,
+		.round = efp->check[idx_check::round] != check_data::unchecked,
+		.gradient = efp->check[idx_check::gradient],
+		.angle = static_cast<float>(angle) / den_angle,
+		.simplify = static_cast<float>(simplify) / den_simplify,
+		.field = field,
+		.concave = concave,
+		.shape = efp->check[idx_check::shape],
+		.col = render::fromRGB(exdata->color.r, exdata->color.g, exdata->color.b),
+		.col2 = render::fromRGB(exdata->color2.r, exdata->color2.g, exdata->color2.b),
+		.img = img ? &pat : nullptr,
+	};
+
+	// keep the input aside if slow frames are to be captured, as it may be overwritten in place.
+	bool const capturing = capture::budget() > 0;
+	std::vector<i16> alpha_in{};
+	if (capturing) alpha_in = capture::alpha_plane(as_pixels(efpip->obj_edit), src_w, src_h, efpip->obj_line);
+	auto const t0 = std::chrono::steady_clock::now();
+
+	// compose into obj_temp, or over obj_edit in place when there's no margin.
+	render::compose(p, as_pixels(efpip->obj_edit), efpip->obj_w, efpip->obj_h, efpip->obj_line,
+		as_pixels(margin > 0 ? efpip->obj_temp : efpip->obj_edit), efpip->obj_line);
+
+	if (capturing) {
+		if (double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			seconds > capture::budget()) {
+			auto const exdata_bytes = reinterpret_cast<uint8_t const*>(exdata);
+			capture::save({
+				.w = src_w, .h = src_h, .line = efpip->obj_line,
+				.track = { efp->track, efp->track + idx_track::count_entries },
+				.check = { efp->check, efp->check + idx_check::count_entries },
+				.exdata = { exdata_bytes, exdata_bytes + sizeof(Exdata) },
+				.p = p,
+				.pat_w = pat.w, .pat_h = pat.h, .pat_ox = pat.ox, .pat_oy = pat.oy,
+				.seconds = seconds,
+				.alpha = std::move(alpha_in),
 			});
 		}
-		return TRUE;
 	}
+	if (margin == 0) return TRUE;
 
-	if (tiled_image img{ relative_path::absolute{exdata->file}.abs_path.c_str(), img_x, img_y, extend, efp, *exedit.memory_ptr }) {
-		auto blend = [&](i16 back, ExEdit::PixelYCA const& src, int i_x, int i_y) -> ExEdit::PixelYCA {
-			i16 a = (f_alpha * src.a) >> log2_max_alpha;
-			if (a >= max_alpha) return src;
-
-			i16 A = (alpha * back) >> log2_max_alpha;
-			if (A <= 0) return { .y = src.y, .cb = src.cb, .cr = src.cr, .a = a };
-
-			ExEdit::PixelYCA col = img[i_x + i_y * efpip->obj_line];
-			A = (A * col.a) >> log2_max_alpha;
-			if (a <= 0) return { .y = col.y, .cb = col.cb, .cr = col.cr, .a = A };
-
-			A = ((max_alpha - a) * A) >> log2_max_alpha;
-			return {
-				.y  = static_cast<i16>((a * src.y  + A * col.y ) / (a + A)),
-				.cb = static_cast<i16>((a * src.cb + A * col.cb) / (a + A)),
-				.cr = static_cast<i16>((a * src.cr + A * col.cr) / (a + A)),
-				.a  = static_cast<i16>(a + A),
-			};
-		};
-		auto paint = [&](i16 back, int i_x, int i_y) -> ExEdit::PixelYCA {
-			i16 A = (alpha * back) >> log2_max_alpha;
-			if (A <= 0) return { .a = 0 };
-
-			ExEdit::PixelYCA col = img[i_x + i_y * efpip->obj_line];
-			A = (A * col.a) >> log2_max_alpha;
-			return { .y = col.y, .cb = col.cb, .cr = col.cr, .a = A };
-		};
-
-		multi_thread(dst_h, [&](int thread_id, int thread_num) {
-			for (int y = thread_id; y < dst_h; y += thread_num) {
-				auto* dst_y = &efpip->obj_temp[y * efpip->obj_line];
-				int i_y = (y + img.oy) % img.h;
-				int i_x = img.ox;
-				auto incr_x = [&] {i_x++; if (i_x >= img.w) i_x -= img.w; };
-				if (y < extend || y >= dst_h - extend) {
-					for (int x = dst_w; --x >= 0; dst_y++, incr_x())
-						*dst_y = paint(dst_y->a, i_x, i_y);
-				}
-				else {
-					for (int x = extend; --x >= 0; dst_y++, incr_x())
-						*dst_y = paint(dst_y->a, i_x, i_y);
-
-					auto* src_y = &efpip->obj_edit[(y - extend) * efpip->obj_line];
-					for (int x = src_w; --x >= 0; dst_y++, incr_x(), src_y++)
-						*dst_y = blend(dst_y->a, *src_y, i_x, i_y);
-
-					for (int x = extend; --x >= 0; dst_y++, incr_x())
-						*dst_y = paint(dst_y->a, i_x, i_y);
-				}
-			}
-		});
-	}
-	else {
-		auto const col = fromRGB(exdata->color.r, exdata->color.g, exdata->color.b);
-		auto blend = [&](i16 back, ExEdit::PixelYCA const& src) -> ExEdit::PixelYCA {
-			i16 a = (f_alpha * src.a) >> log2_max_alpha;
-			if (a >= max_alpha) return src;
-
-			i16 A = (alpha * back) >> log2_max_alpha;
-			if (A <= 0) return { .y = src.y, .cb = src.cb, .cr = src.cr, .a = a };
-			if (a <= 0) return { .y = col.y, .cb = col.cb, .cr = col.cr, .a = A };
-
-			A = ((max_alpha - a) * A) >> log2_max_alpha;
-			return {
-				.y  = static_cast<i16>((a * src.y  + A * col.y ) / (a + A)),
-				.cb = static_cast<i16>((a * src.cb + A * col.cb) / (a + A)),
-				.cr = static_cast<i16>((a * src.cr + A * col.cr) / (a + A)),
-				.a  = static_cast<i16>(a + A),
-			};
-		};
-		auto paint = [&](i16 back) -> ExEdit::PixelYCA {
-			i16 A = (alpha * back) >> log2_max_alpha;
-			return { .y = col.y, .cb = col.cb, .cr = col.cr, .a = A };
-		};
-
-		multi_thread(dst_h, [&](int thread_id, int thread_num) {
-			for (int y = thread_id; y < dst_h; y += thread_num) {
-				auto* dst_y = &efpip->obj_temp[y * efpip->obj_line];
-				if (y < extend || y >= dst_h - extend) {
-					for (int x = dst_w; --x >= 0; dst_y++)
-						*dst_y = paint(dst_y->a);
-				}
-				else {
-					for (int x = extend; --x >= 0; dst_y++)
-						*dst_y = paint(dst_y->a);
-
-					auto* src_y = &efpip->obj_edit[(y - extend) * efpip->obj_line];
-					for (int x = src_w; --x >= 0; dst_y++, src_y++)
-						*dst_y = blend(dst_y->a, *src_y);
-
-					for (int x = extend; --x >= 0; dst_y++)
-						*dst_y = paint(dst_y->a);
-				}
-			}
-		});
-	}
 	std::swap(efpip->obj_edit, efpip->obj_temp);
-	efpip->obj_w += 2 * extend;
-	efpip->obj_h += 2 * extend;
+	efpip->obj_w += 2 * margin;
+	efpip->obj_h += 2 * margin;
 	return TRUE;
 }
 
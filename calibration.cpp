@@ -0,0 +1,180 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "multi_thread.hpp"
+#include "convex_closure.hpp"
+#include "distance_field.hpp"
+#include "calibration.hpp"
+
+using namespace convex_closure;
+
+
+////////////////////////////////
+// 並列化の閾値の計測．
+////////////////////////////////
+constexpr char ini_section[] = "cutoff", ini_key_threads[] = "threads";
+constexpr char const* ini_keys[] = { "scan", "graham", "extend", "edges", "fill", "field" };
+static_assert(std::size(ini_keys) == static_cast<size_t>(work_phase::count));
+
+std::string calibration::ini_path()
+{
+	HMODULE mod = nullptr;
+	::GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+		reinterpret_cast<char const*>(&calibration::ini_path), &mod);
+
+	std::string path;
+	path.resize_and_overwrite(MAX_PATH - 1,
+		[mod](auto p, auto c) { return ::GetModuleFileNameA(mod, p, c + 1); });
+	if (auto const pos = path.find_last_of("./\\"); pos != std::string::npos && path[pos] == '.')
+		path.erase(pos);
+	return path + ".ini";
+}
+
+// the shortest time in seconds among some trials of `func`.
+static double measure(auto&& func)
+{
+	constexpr int trials = 8;
+	double best = std::numeric_limits<double>::infinity();
+	for (int i = trials; --i >= 0;) {
+		auto const t0 = std::chrono::steady_clock::now();
+		func();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+	}
+	return best;
+}
+
+void calibration::run()
+{
+	constexpr size_t num_phases = static_cast<size_t>(work_phase::count);
+	int const num_threads = multi_thread.num_threads();
+	auto& cutoffs = multi_thread.cutoffs;
+
+	constexpr int32_t never = std::numeric_limits<int32_t>::max();
+
+	if (num_threads <= 1) std::fill(std::begin(cutoffs), std::end(cutoffs), never);
+	else {
+		// the cost of a dispatch to the threads that does nothing.
+		double const dispatch = measure([] { multi_thread(false, [](int, int) {}); });
+
+		// the cost of each phase per unit of work, measured single-threaded.
+		double unit[num_phases]{};
+		std::fill(std::begin(cutoffs), std::end(cutoffs), never);
+		auto const per = [](double time, int work) { return std::max(time, 0.0) / std::max(work, 1); };
+
+		// a transparent image small enough to be scanned every line.
+		{
+			constexpr int size = coarse_min_size - 16;
+			std::vector<i16> src(4 * size * size, 0);
+			std::vector<int> heap(hull::heap_size(size) / sizeof(int));
+			hull h{ heap.data(), size };
+			unit[static_cast<size_t>(work_phase::scan)] = per(measure([&] {
+				find_key_points<4>(h, &src[3], size, size, 4 * size, i16{ 0 }, false);
+			}), size * size);
+		}
+
+		// a disc, given as the result of the scan.
+		{
+			constexpr int size = 512, extend = 16, c = size / 2, r = 3 * size / 8,
+				dst_size = size + 2 * extend;
+			std::vector<int> heap(2 * hull::heap_size(dst_size) / sizeof(int));
+			hull h{ heap.data(), dst_size }, work{ heap.data() + hull::heap_size(dst_size) / sizeof(int), dst_size };
+
+			bound bd = bound::empty(size, size);
+			for (int y = 0; y < size; y++) {
+				int const d2 = r * r - (y - c) * (y - c);
+				if (d2 < 0) {
+					h.heap1[y] = size; h.heap1[size + y] = 0;
+					continue;
+				}
+				int const half = static_cast<int>(std::sqrt(d2)), xl = c - half, xr = c + half;
+				h.heap1[y] = xl; h.heap1[size + y] = ~xr;
+				bd.top = std::min(bd.top, y); bd.btm = y;
+				if (xl < bd.l_min) { bd.l_min = xl; bd.l_min_top = y; }
+				if (xl == bd.l_min) bd.l_min_btm = y;
+				if (xr > bd.r_max) { bd.r_max = xr; bd.r_max_top = y; }
+				if (xr == bd.r_max) bd.r_max_btm = y;
+			}
+			unit[static_cast<size_t>(work_phase::graham)] = per(measure([&] {
+				find_key_points(h, bd, size);
+			}), 2 * (bd.btm - bd.top + 1));
+
+			unit[static_cast<size_t>(work_phase::extend)] = per(
+				measure([&] { h.copy_to(work); extend_key_points<true>(work, size, size, extend); }) -
+				measure([&] { h.copy_to(work); }),
+				h.LT.count + h.LB.count + h.RT.count + h.RB.count);
+
+			std::vector<i16> dst(4 * dst_size * dst_size);
+			unit[static_cast<size_t>(work_phase::edges)] = per(measure([&] {
+				rasterize_edges<4, true>(work, &dst[3], 4 * dst_size, extend);
+			}), 2 * (work.LB.btm + 1 - work.LT.top));
+			unit[static_cast<size_t>(work_phase::fill)] = per(measure([&] {
+				for (int y = 0; y < dst_size; y++)
+					rasterize_line<4>(work, &dst[3], dst_size, 4 * dst_size, extend, y);
+			}), dst_size * dst_size);
+
+			auto const line = field_rasterizer<4>({ work, work.LT.x_map }, &dst[3], dst_size, 4 * dst_size, extend,
+				-2.0f, 2.0f, [](float d) { return static_cast<i16>(std::clamp(0.5f - d / 4, 0.0f, 1.0f) * max_alpha); });
+			unit[static_cast<size_t>(work_phase::field)] = per(measure([&] {
+				for (int y = 0; y < dst_size; y++) line(y);
+			}), dst_size * dst_size);
+		}
+
+		// the amount of work n where the single thread takes as long as the dispatch plus the parallel run,
+		// n * unit = dispatch + n * unit / p, where p is the number of threads that can share the phase.
+		constexpr int max_split[] = { 0, 4, 4, 6, 0, 0 }; // 0 for as many as the threads.
+		static_assert(std::size(max_split) == num_phases);
+		for (size_t i = 0; i < num_phases; i++) {
+			int const p = max_split[i] > 0 ? std::min(max_split[i], num_threads) : num_threads;
+			double const n = dispatch / (std::max(unit[i], 1e-12) * (1 - 1.0 / p));
+			cutoffs[i] = static_cast<int32_t>(std::min(std::ceil(n), double{ never }));
+		}
+	}
+
+	// save them.
+	auto const path = calibration::ini_path();
+	::WritePrivateProfileStringA(ini_section, ini_key_threads, std::to_string(num_threads).c_str(), path.c_str());
+	for (size_t i = 0; i < num_phases; i++)
+		::WritePrivateProfileStringA(ini_section, ini_keys[i], std::to_string(cutoffs[i]).c_str(), path.c_str());
+}
+
+bool calibration::ensure()
+{
+	// once for each number of threads.
+	static int32_t last_threads = 0;
+	static bool saved = false;
+	int const num_threads = multi_thread.num_threads();
+	if (last_threads == num_threads) return saved;
+	last_threads = num_threads;
+
+	// those for another number of threads don't apply, so fall back to the defaults.
+	auto const path = calibration::ini_path();
+	MultiThread const initial{};
+	auto const& defaults = initial.cutoffs;
+	saved = ::GetPrivateProfileIntA(ini_section, ini_key_threads, 0, path.c_str()) == num_threads;
+	for (size_t i = 0; i < std::size(ini_keys); i++) {
+		multi_thread.cutoffs[i] = saved ?
+			::GetPrivateProfileIntA(ini_section, ini_keys[i], defaults[i], path.c_str()) : defaults[i];
+	}
+	return saved;
+}
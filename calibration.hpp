@@ -0,0 +1,35 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+
+////////////////////////////////
+// 並列化の閾値の計測．
+////////////////////////////////
+// the cutoffs of multi_thread for each work_phase are measured on request,
+// and kept in `ConvexClosure_S.ini` next to the plugin, for the number of threads at the time.
+namespace calibration
+{
+	// loads the cutoffs saved for the current number of threads, and returns false if there are none,
+	// leaving the defaults, as the measurement takes too long to be done in the middle of drawing.
+	bool ensure();
+
+	// measures the cutoffs anew, and saves them to the file.
+	void run();
+
+	// the path to the file, named after this plugin, which may hold other settings for the machine too.
+	std::string ini_path();
+}
@@ -0,0 +1,217 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "calibration.hpp"
+#include "render.hpp"
+#include "capture.hpp"
+
+using namespace capture;
+
+
+////////////////////////////////
+// 重いフレームの記録．
+////////////////////////////////
+constexpr char ini_section[] = "capture", ini_key_folder[] = "folder",
+	ini_key_budget[] = "budget_ms", ini_key_max_count[] = "max_count";
+constexpr int default_budget = 50, default_max_count = 100;
+
+// the limits of the sizes read from a file, including the margin, beyond what ExEdit can hold for an object,
+// so a broken file is rejected before the replay allocates for it.
+constexpr int max_size = 1 << 13;
+
+// the head of the file, followed by the tracks, the checks and the exdata,
+// and the runs of the alpha plane as pairs of the value and the length in u16.
+struct record {
+	constexpr static uint32_t magic_id = 'C' | 'C' << 8 | 'F' << 16 | '2' << 24;
+	uint32_t magic;
+	uint32_t runs;
+	double seconds;
+	int32_t w, h, line;
+	int32_t track_n, check_n, exdata_size;
+	int32_t extend, stroke, feather, gap, alpha, f_alpha, threshold, gradient, field, concave;
+	uint8_t draft, antialias, separate, round;
+	float angle, simplify;
+	i16 col[4], col2[4];
+	int32_t pat_w, pat_h, pat_ox, pat_oy;
+	int32_t shape; // left zero before it was added.
+};
+static_assert(sizeof(record) == 128);
+
+namespace
+{
+	struct settings {
+		std::filesystem::path folder;
+		double budget = 0;
+		int max_count = 0;
+	};
+	settings const& config()
+	{
+		static settings const s = [] {
+			settings s{};
+			auto const ini = calibration::ini_path();
+			std::string path;
+			path.resize_and_overwrite(MAX_PATH - 1, [&](auto p, auto c) {
+				return ::GetPrivateProfileStringA(ini_section, ini_key_folder, "", p, static_cast<DWORD>(c + 1), ini.c_str());
+			});
+			if (path.empty()) return s;
+
+			// relative to the folder of the .ini.
+			if (!(path.starts_with("\\\\") || (path.size() >= 2 && path[1] == ':')))
+				path = ini.substr(0, ini.find_last_of("/\\") + 1) + path;
+			s.folder = path;
+			s.budget = std::max(static_cast<int>(
+				::GetPrivateProfileIntA(ini_section, ini_key_budget, default_budget, ini.c_str())), 0) * 1e-3;
+			s.max_count = std::max(static_cast<int>(
+				::GetPrivateProfileIntA(ini_section, ini_key_max_count, default_max_count, ini.c_str())), 0);
+			if (s.max_count == 0) s.budget = 0;
+			return s;
+		}();
+		return s;
+	}
+	std::atomic<int> count_saved = 0;
+}
+
+double capture::budget()
+{
+	return config().budget;
+}
+
+std::vector<i16> capture::alpha_plane(pixel const* src, int w, int h, size_t line)
+{
+	std::vector<i16> ret(static_cast<size_t>(w) * h);
+	auto dst = ret.data();
+	for (int y = 0; y < h; y++, src += line) {
+		for (int x = 0; x < w; x++) *dst++ = src[x].a;
+	}
+	return ret;
+}
+
+void capture::save(frame const& f)
+{
+	auto const& s = config();
+	if (s.budget <= 0) return;
+	int const seq = count_saved++;
+	if (seq >= s.max_count) return;
+
+	// most of the alpha plane is either transparent or opaque, so runs of the same values shrink it well enough.
+	std::vector<uint16_t> runs{};
+	for (size_t i = 0, n = f.alpha.size(); i < n;) {
+		size_t j = i + 1;
+		while (j < n && j - i < 0xffff && f.alpha[j] == f.alpha[i]) j++;
+		runs.push_back(static_cast<uint16_t>(f.alpha[i]));
+		runs.push_back(static_cast<uint16_t>(j - i));
+		i = j;
+	}
+
+	record const rec{
+		.magic = record::magic_id,
+		.runs = static_cast<uint32_t>(runs.size() / 2),
+		.seconds = f.seconds,
+		.w = f.w, .h = f.h, .line = f.line,
+		.track_n = static_cast<int32_t>(f.track.size()), .check_n = static_cast<int32_t>(f.check.size()),
+		.exdata_size = static_cast<int32_t>(f.exdata.size()),
+		.extend = f.p.extend, .stroke = f.p.stroke, .feather = f.p.feather, .gap = f.p.gap,
+		.alpha = f.p.alpha, .f_alpha = f.p.f_alpha, .threshold = f.p.threshold,
+		.gradient = f.p.gradient, .field = f.p.field, .concave = f.p.concave,
+		.draft = f.p.draft, .antialias = f.p.antialias, .separate = f.p.separate, .round = f.p.round,
+		.angle = f.p.angle, .simplify = f.p.simplify,
+		.col = { f.p.col.y, f.p.col.cb, f.p.col.cr, f.p.col.a },
+		.col2 = { f.p.col2.y, f.p.col2.cb, f.p.col2.cr, f.p.col2.a },
+		.pat_w = f.pat_w, .pat_h = f.pat_h, .pat_ox = f.pat_ox, .pat_oy = f.pat_oy,
+		.shape = f.p.shape,
+	};
+
+	// named after the time, with the sequence for the frames within the same millisecond.
+	SYSTEMTIME t;
+	::GetLocalTime(&t);
+	char name[64];
+	std::snprintf(name, std::size(name), "%04u%02u%02u-%02u%02u%02u-%03u_%lu_%d.ccap",
+		t.wYear, t.wMonth, t.wDay, t.wHour, t.wMinute, t.wSecond, t.wMilliseconds, ::GetCurrentProcessId(), seq);
+	std::error_code ec;
+	std::filesystem::create_directories(s.folder, ec);
+	std::ofstream file{ s.folder / name, std::ios::binary };
+	auto const write = [&](auto const& data, size_t size) {
+		file.write(reinterpret_cast<char const*>(data), size);
+	};
+	write(&rec, sizeof(rec));
+	write(f.track.data(), sizeof(int32_t) * f.track.size());
+	write(f.check.data(), sizeof(int32_t) * f.check.size());
+	write(f.exdata.data(), f.exdata.size());
+	write(runs.data(), sizeof(uint16_t) * runs.size());
+}
+
+bool capture::load(std::filesystem::path const& path, frame& f)
+{
+	std::ifstream file{ path, std::ios::binary };
+	auto const read = [&](auto data, size_t size) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data), size));
+	};
+
+	record rec;
+	if (!read(&rec, sizeof(rec)) || rec.magic != record::magic_id ||
+		rec.w <= 0 || rec.h <= 0 || rec.line < rec.w || rec.w > max_size || rec.h > max_size || rec.line > max_size ||
+		std::min({ rec.extend, rec.stroke, rec.feather, rec.field, rec.gap, rec.concave }) < 0 ||
+		std::max({ rec.extend, rec.stroke, rec.feather, rec.field, rec.gap, rec.concave }) > max_size ||
+		rec.pat_w > max_size || rec.pat_h > max_size ||
+		rec.track_n < 0 || rec.track_n > 64 || rec.check_n < 0 || rec.check_n > 64 ||
+		rec.exdata_size < 0 || rec.exdata_size > 1 << 16) return false;
+
+	f.w = rec.w; f.h = rec.h; f.line = rec.line;
+	f.track.resize(rec.track_n); f.check.resize(rec.check_n); f.exdata.resize(rec.exdata_size);
+	if (!read(f.track.data(), sizeof(int32_t) * f.track.size()) ||
+		!read(f.check.data(), sizeof(int32_t) * f.check.size()) ||
+		!read(f.exdata.data(), f.exdata.size())) return false;
+
+	f.p = {
+		.extend = rec.extend, .stroke = rec.stroke, .feather = rec.feather, .gap = rec.gap,
+		.alpha = rec.alpha, .f_alpha = rec.f_alpha, .threshold = static_cast<i16>(rec.threshold),
+		.draft = rec.draft != 0, .antialias = rec.antialias != 0, .separate = rec.separate != 0, .round = rec.round != 0,
+		.gradient = rec.gradient, .angle = rec.angle, .simplify = rec.simplify, .field = rec.field, .concave = rec.concave,
+		.shape = rec.shape,
+		.col = { rec.col[0], rec.col[1], rec.col[2], rec.col[3] },
+		.col2 = { rec.col2[0], rec.col2[1], rec.col2[2], rec.col2[3] },
+		.img = nullptr,
+	};
+	if (int const margin = f.p.margin(); f.w + 2 * margin > max_size || f.h + 2 * margin > max_size) return false;
+	f.pat_w = std::max(rec.pat_w, 0); f.pat_h = std::max(rec.pat_h, 0);
+	f.pat_ox = rec.pat_ox; f.pat_oy = rec.pat_oy;
+	f.seconds = rec.seconds;
+
+	// the runs should cover the plane exactly, each at least a pixel long and at most 0xffff,
+	// which bounds their number before allocating for them.
+	size_t const n = static_cast<size_t>(f.w) * f.h;
+	if (rec.runs > n || n > size_t{ 0xffff } * rec.runs) return false;
+	std::vector<uint16_t> runs(2 * static_cast<size_t>(rec.runs));
+	if (!read(runs.data(), sizeof(uint16_t) * runs.size())) return false;
+	f.alpha.clear();
+	f.alpha.reserve(n);
+	for (size_t i = 0; i < runs.size(); i += 2) {
+		if (runs[i + 1] == 0 || f.alpha.size() + runs[i + 1] > n) return false;
+		f.alpha.insert(f.alpha.end(), runs[i + 1], static_cast<i16>(runs[i]));
+	}
+	return f.alpha.size() == n;
+}
@@ -0,0 +1,56 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include "render.hpp"
+
+
+////////////////////////////////
+// 重いフレームの記録．
+////////////////////////////////
+// frames that take longer than `budget_ms` in the section `[capture]` of `ConvexClosure_S.ini`
+// are written into the folder named by the key `folder`, so they can be replayed by the command-line tool.
+namespace capture
+{
+	using i16 = render::i16;
+	using pixel = render::pixel;
+
+	// a frame as the filter got it, enough to draw it again without AviUtl.
+	struct frame {
+		int w, h, line; // obj_w, obj_h and obj_line.
+		std::vector<int32_t> track, check; // the raw values of the filter.
+		std::vector<uint8_t> exdata;
+		render::params p; // as passed to render::compose(), where `img` is left null.
+		int pat_w, pat_h, pat_ox, pat_oy; // the pattern image, whose pixels are not kept. zero if none.
+		double seconds; // the time render::compose() took.
+		std::vector<i16> alpha; // w * h, only the alpha of the input.
+	};
+
+	// the time limit in seconds, or zero if not capturing. read once from the .ini.
+	double budget();
+
+	// copies the alpha of the image, `line` pixels per row.
+	std::vector<i16> alpha_plane(pixel const* src, int w, int h, size_t line);
+
+	// writes the frame into a new file in the folder, up to `max_count` files in a session.
+	void save(frame const& f);
+
+	// reads a file written by save().
+	bool load(std::filesystem::path const& path, frame& f);
+}
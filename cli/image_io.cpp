@@ -0,0 +1,195 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include "image_io.hpp"
+
+using namespace image_io;
+using Microsoft::WRL::ComPtr;
+using render::i16, render::max_alpha, render::log2_max_alpha;
+
+
+////////////////////////////////
+// 色の変換．
+////////////////////////////////
+void image_io::from_rgba(pixel* dst, uint8_t const* rgba, size_t n)
+{
+	for (; n > 0; n--, dst++, rgba += 4) {
+		*dst = render::fromRGB(rgba[0], rgba[1], rgba[2]);
+		dst->a = static_cast<i16>((rgba[3] * max_alpha + 127) / 255);
+	}
+}
+
+void image_io::to_rgba(uint8_t* rgba, pixel const* src, size_t n)
+{
+	// the inverse of render::fromRGB(), in 14-bit fixed point.
+	constexpr auto to_8bit = [](int v) {
+		return static_cast<uint8_t>(std::clamp((v * 255 + max_alpha / 2) >> log2_max_alpha, 0, 255));
+	};
+	for (; n > 0; n--, src++, rgba += 4) {
+		int const y = src->y, cb = src->cb, cr = src->cr;
+		rgba[0] = to_8bit(y + ((cr * 22970) >> 14));
+		rgba[1] = to_8bit(y - ((cb * 5638 + cr * 11700) >> 14));
+		rgba[2] = to_8bit(y + ((cb * 29032) >> 14));
+		rgba[3] = to_8bit(src->a);
+	}
+}
+
+
+////////////////////////////////
+// 画像ファイル．
+////////////////////////////////
+static ComPtr<IWICImagingFactory> factory{};
+
+bool image_io::startup()
+{
+	if (factory != nullptr) return true;
+	return SUCCEEDED(::CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)));
+}
+
+static ComPtr<IWICBitmapFrameDecode> first_frame(wchar_t const* path)
+{
+	ComPtr<IWICBitmapDecoder> decoder{};
+	ComPtr<IWICBitmapFrameDecode> frame{};
+	if (FAILED(factory->CreateDecoderFromFilename(path, nullptr, GENERIC_READ,
+		WICDecodeMetadataCacheOnDemand, &decoder)) ||
+		FAILED(decoder->GetFrame(0, &frame))) return nullptr;
+	return frame;
+}
+
+bool image_io::image_size(wchar_t const* path, int& w, int& h)
+{
+	auto const frame = first_frame(path);
+	UINT uw, uh;
+	if (frame == nullptr || FAILED(frame->GetSize(&uw, &uh))) return false;
+	w = static_cast<int>(uw); h = static_cast<int>(uh);
+	return true;
+}
+
+bool image_io::load_image(wchar_t const* path, std::vector<uint8_t>& rgba, int& w, int& h)
+{
+	auto const frame = first_frame(path);
+	ComPtr<IWICFormatConverter> converter{};
+	UINT uw, uh;
+	if (frame == nullptr || FAILED(frame->GetSize(&uw, &uh)) ||
+		FAILED(factory->CreateFormatConverter(&converter)) ||
+		FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA,
+			WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom))) return false;
+
+	w = static_cast<int>(uw); h = static_cast<int>(uh);
+	rgba.resize(size_t{ 4 } * uw * uh);
+	return SUCCEEDED(converter->CopyPixels(nullptr, 4 * uw, static_cast<UINT>(rgba.size()), rgba.data()));
+}
+
+bool image_io::save_png(wchar_t const* path, uint8_t const* rgba, int w, int h)
+{
+	ComPtr<IWICStream> stream{};
+	ComPtr<IWICBitmapEncoder> encoder{};
+	ComPtr<IWICBitmapFrameEncode> frame{};
+	if (FAILED(factory->CreateStream(&stream)) ||
+		FAILED(stream->InitializeFromFilename(path, GENERIC_WRITE)) ||
+		FAILED(factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &encoder)) ||
+		FAILED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache)) ||
+		FAILED(encoder->CreateNewFrame(&frame, nullptr)) ||
+		FAILED(frame->Initialize(nullptr)) ||
+		FAILED(frame->SetSize(w, h))) return false;
+
+	// the encoder may ask for BGRA instead.
+	WICPixelFormatGUID format = GUID_WICPixelFormat32bppRGBA;
+	if (FAILED(frame->SetPixelFormat(&format))) return false;
+	UINT const stride = 4 * w, size = stride * h;
+	std::vector<uint8_t> bgra{};
+	if (format == GUID_WICPixelFormat32bppBGRA) {
+		bgra.assign(rgba, rgba + size);
+		for (size_t i = 0; i < size; i += 4) std::swap(bgra[i], bgra[i + 2]);
+		rgba = bgra.data();
+	}
+	else if (format != GUID_WICPixelFormat32bppRGBA) return false;
+
+	return SUCCEEDED(frame->WritePixels(h, stride, size, const_cast<BYTE*>(rgba))) &&
+		SUCCEEDED(frame->Commit()) && SUCCEEDED(encoder->Commit());
+}
+
+
+////////////////////////////////
+// メモリマップトファイル．
+////////////////////////////////
+mapped_file::~mapped_file()
+{
+	if (mapping != nullptr) ::CloseHandle(mapping);
+	if (file != nullptr) ::CloseHandle(file);
+}
+
+bool mapped_file::open(wchar_t const* path)
+{
+	file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { file = nullptr; return false; }
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) return false;
+	len = static_cast<uint64_t>(size.QuadPart);
+	mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	return mapping != nullptr;
+}
+
+bool mapped_file::create(wchar_t const* path, uint64_t size)
+{
+	file = ::CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { file = nullptr; return false; }
+	if (size == 0) return true;
+
+	// the file is extended to the size of the mapping.
+	len = size;
+	writable = true;
+	mapping = ::CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+	return mapping != nullptr;
+}
+
+mapped_file::view mapped_file::map(uint64_t offset, size_t size) const
+{
+	// the offset of a view must be a multiple of the allocation granularity.
+	static DWORD const granularity = [] { SYSTEM_INFO info; ::GetSystemInfo(&info); return info.dwAllocationGranularity; }();
+	uint64_t const start = offset / granularity * granularity;
+
+	view v{};
+	if (mapping == nullptr || offset + size > len) return v;
+	v.base = ::MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+		static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), static_cast<size_t>(offset - start) + size);
+	if (v.base != nullptr) v.ptr = static_cast<uint8_t*>(v.base) + (offset - start);
+	return v;
+}
+
+mapped_file::view& mapped_file::view::operator=(view&& other) noexcept
+{
+	if (this != &other) {
+		if (base != nullptr) ::UnmapViewOfFile(base);
+		base = std::exchange(other.base, nullptr);
+		ptr = std::exchange(other.ptr, nullptr);
+	}
+	return *this;
+}
+
+mapped_file::view::~view()
+{
+	if (base != nullptr) ::UnmapViewOfFile(base);
+}
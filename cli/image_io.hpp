@@ -0,0 +1,74 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "render.hpp"
+
+
+////////////////////////////////
+// 画像の入出力．
+////////////////////////////////
+namespace image_io
+{
+	using pixel = render::pixel;
+
+	// 8-bit RGBA of straight alpha, converted from/to the pixels of ExEdit.
+	void from_rgba(pixel* dst, uint8_t const* rgba, size_t n);
+	void to_rgba(uint8_t* rgba, pixel const* src, size_t n);
+
+	// image files by Windows Imaging Component, as 8-bit RGBA. startup() must be called first.
+	// loading accepts any format WIC can decode, and saving writes PNG. they return false on failure.
+	bool startup();
+	bool image_size(wchar_t const* path, int& w, int& h);
+	bool load_image(wchar_t const* path, std::vector<uint8_t>& rgba, int& w, int& h);
+	bool save_png(wchar_t const* path, uint8_t const* rgba, int w, int h);
+
+	// a file mapped into memory part by part, so streams larger than the address space still work.
+	class mapped_file {
+		void* file = nullptr, * mapping = nullptr;
+		uint64_t len = 0;
+		bool writable = false;
+
+	public:
+		// a range of the file in memory, valid while this object lives.
+		class view {
+			void* base = nullptr;
+			uint8_t* ptr = nullptr;
+			friend class mapped_file;
+
+		public:
+			view() = default;
+			view(view&& other) noexcept : base{ other.base }, ptr{ other.ptr } { other.base = nullptr; other.ptr = nullptr; }
+			view& operator=(view&& other) noexcept;
+			~view();
+			uint8_t* data() const { return ptr; }
+			explicit operator bool() const { return ptr != nullptr; }
+		};
+
+		mapped_file() = default;
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+		~mapped_file();
+
+		// opens an existing file for reading, or creates one of `size` bytes for writing.
+		bool open(wchar_t const* path);
+		bool create(wchar_t const* path, uint64_t size);
+		uint64_t size() const { return len; }
+
+		view map(uint64_t offset, size_t size) const;
+	};
+}
@@ -0,0 +1,525 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "multi_thread.hpp"
+#include "calibration.hpp"
+#include "kernels.hpp"
+#include "convex_closure.hpp"
+#include "hull_builder.hpp"
+#include "render.hpp"
+#include "capture.hpp"
+#include "image_io.hpp"
+
+using render::pixel, render::max_alpha;
+namespace fs = std::filesystem;
+
+
+////////////////////////////////
+// コマンドライン引数．
+////////////////////////////////
+constexpr wchar_t usage[] = LR"(usage:
+  ConvexClosure_CLI [options] <image>... -o <folder>
+  ConvexClosure_CLI [options] --raw <file> --size <w>x<h> [--format yca|rgba] -o <file>
+  ConvexClosure_CLI [--threads <n>] [--repeat <n>] --replay <capture>...
+
+Draws the convex closure behind each image, as the filter "ConvexClosure_S" does.
+Images are read by Windows Imaging Component (wildcards allowed) and saved as PNG
+of the same names into <folder>. A raw stream is a sequence of frames of ExEdit's
+YCA (4 x int16 per pixel) or of 8-bit RGBA, and the output is in the same format,
+larger by the margin on each side. Captures of slow frames written by the filter
+are drawn again with their own parameters and timed in each phase (wildcards allowed).
+
+options, in the units of the trackbars of the filter:
+  --margin <px>          0 to 500 (default 0)
+  --transp <%>           0 to 100 (default 0)
+  --inner-transp <%>     0 to 100 (default 0)
+  --threshold <%>        0 to 100 (default 50)
+  --feather <px>         0 to 500 (default 0)
+  --stroke <px>          0 to 500 (default 0)
+  --gap <px>             0 to 100 (default 0), used with --separate
+  --angle <deg>          -360 to 360 (default 0), for linear gradients
+  --simplify <px>        0 to 50 (default 0), error allowed to reduce the vertices
+  --field <px>           0 to 500 (default 0), writes the distance within this range
+                         from the polygon into the alpha instead of drawing it
+  --concave <px>         0 to 1000 (default 0), draws a tighter shape instead,
+                         leaving the dents wider than this
+  --shape <0-3>          convex closure, or the least enclosing rectangle,
+                         circle or ellipse
+  --color <RRGGBB>       (default 000000)
+  --color2 <RRGGBB>      (default ffffff)
+  --gradient <0-4>       none, linear, radial, linear/radial over the convex closure
+  --pattern <image>      fills with the image instead of the colors
+  --img-x <px>, --img-y <px>
+                         -4000 to 4000 (default 0), the offset of the pattern
+  --no-antialias, --separate, --draft, --round
+  --threads <n>          threads to use in total (default: all)
+  --jobs <n>             frames processed at once (default: chosen by the size)
+  --repeat <n>           times to draw each capture (default 10)
+)";
+
+struct options {
+	std::vector<fs::path> inputs;
+	fs::path output, raw, pattern;
+	bool raw_rgba = false, replay = false;
+	int raw_w = 0, raw_h = 0, repeat = 10;
+
+	double margin = 0, transp = 0, f_transp = 0, threshold = 50,
+		feather = 0, stroke = 0, gap = 0, angle = 0, simplify = 0, field = 0, concave = 0, img_x = 0, img_y = 0;
+	uint32_t color = 0x000000, color2 = 0xffffff;
+	int gradient = 0, shape = 0;
+	bool antialias = true, separate = false, draft = false, round = false;
+	int threads = 0, jobs = 0;
+};
+
+// expands the wildcards in the file name, in the order of the names.
+static void expand(std::vector<fs::path>& paths, wchar_t const* arg)
+{
+	if (std::wcspbrk(arg, L"*?") == nullptr) { paths.emplace_back(arg); return; }
+
+	size_t const first = paths.size();
+	auto const dir = fs::path{ arg }.parent_path();
+	WIN32_FIND_DATAW fd;
+	HANDLE const h = ::FindFirstFileW(arg, &fd);
+	if (h == INVALID_HANDLE_VALUE) return;
+	do {
+		if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			paths.emplace_back(dir / fd.cFileName);
+	} while (::FindNextFileW(h, &fd));
+	::FindClose(h);
+	std::sort(paths.begin() + first, paths.end());
+}
+
+static bool parse(options& opt, int argc, wchar_t* argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		std::wstring_view const arg = argv[i];
+		auto const next = [&]() -> wchar_t const* { return i + 1 < argc ? argv[++i] : nullptr; };
+		auto const number = [&](auto& val) {
+			auto const s = next();
+			if (s == nullptr) return false;
+			wchar_t* end;
+			val = static_cast<std::remove_reference_t<decltype(val)>>(std::wcstod(s, &end));
+			return *end == L'\0';
+		};
+		auto const color = [&](uint32_t& val) {
+			auto const s = next();
+			if (s == nullptr) return false;
+			wchar_t* end;
+			val = std::wcstoul(s, &end, 16);
+			return *end == L'\0' && val <= 0xffffff;
+		};
+		auto const path = [&](fs::path& val) {
+			auto const s = next();
+			if (s != nullptr) val = s;
+			return s != nullptr;
+		};
+
+		bool ok = true;
+		if (arg == L"-o") ok = path(opt.output);
+		else if (arg == L"--raw") ok = path(opt.raw);
+		else if (arg == L"--replay") opt.replay = true;
+		else if (arg == L"--repeat") ok = number(opt.repeat) && opt.repeat > 0;
+		else if (arg == L"--size") {
+			auto const s = next();
+			ok = s != nullptr && std::swscanf(s, L"%dx%d", &opt.raw_w, &opt.raw_h) == 2 && opt.raw_w > 0 && opt.raw_h > 0;
+		}
+		else if (arg == L"--format") {
+			auto const s = next();
+			ok = s != nullptr && (std::wcscmp(s, L"yca") == 0 || std::wcscmp(s, L"rgba") == 0);
+			if (ok) opt.raw_rgba = std::wcscmp(s, L"rgba") == 0;
+		}
+		else if (arg == L"--margin") ok = number(opt.margin);
+		else if (arg == L"--transp") ok = number(opt.transp);
+		else if (arg == L"--inner-transp") ok = number(opt.f_transp);
+		else if (arg == L"--threshold") ok = number(opt.threshold);
+		else if (arg == L"--feather") ok = number(opt.feather);
+		else if (arg == L"--stroke") ok = number(opt.stroke);
+		else if (arg == L"--gap") ok = number(opt.gap);
+		else if (arg == L"--angle") ok = number(opt.angle);
+		else if (arg == L"--simplify") ok = number(opt.simplify);
+		else if (arg == L"--field") ok = number(opt.field);
+		else if (arg == L"--concave") ok = number(opt.concave);
+		else if (arg == L"--img-x") ok = number(opt.img_x);
+		else if (arg == L"--img-y") ok = number(opt.img_y);
+		else if (arg == L"--color") ok = color(opt.color);
+		else if (arg == L"--color2") ok = color(opt.color2);
+		else if (arg == L"--gradient") ok = number(opt.gradient) && 0 <= opt.gradient && opt.gradient <= 4;
+		else if (arg == L"--shape") ok = number(opt.shape) && 0 <= opt.shape && opt.shape <= 3;
+		else if (arg == L"--pattern") ok = path(opt.pattern);
+		else if (arg == L"--no-antialias") opt.antialias = false;
+		else if (arg == L"--separate") opt.separate = true;
+		else if (arg == L"--round") opt.round = true;
+		else if (arg == L"--draft") opt.draft = true;
+		else if (arg == L"--threads") ok = number(opt.threads);
+		else if (arg == L"--jobs") ok = number(opt.jobs);
+		else if (arg.starts_with(L"-")) ok = false;
+		else expand(opt.inputs, argv[i]);
+
+		if (!ok) {
+			std::fwprintf(stderr, L"invalid argument: %ls\n", argv[i]);
+			return false;
+		}
+	}
+	if (opt.replay) return !opt.inputs.empty() && opt.raw.empty() && opt.output.empty();
+	return !opt.output.empty() && (opt.raw.empty() ? !opt.inputs.empty() : opt.inputs.empty() && opt.raw_w > 0);
+}
+
+
+////////////////////////////////
+// 記録したフレームの再生．
+////////////////////////////////
+constexpr wchar_t const* phase_names[] = { L"scan", L"graham", L"extend", L"edges", L"fill", L"field" };
+static_assert(std::size(phase_names) == static_cast<size_t>(work_phase::count));
+
+static int replay(options const& opt)
+{
+	int failed = 0;
+	for (auto const& path : opt.inputs) {
+		capture::frame f{};
+		if (!capture::load(path, f)) {
+			std::fwprintf(stderr, L"failed to load the capture: %ls\n", path.c_str());
+			failed++;
+			continue;
+		}
+
+		// only the alpha is kept, which decides the shape. the pattern is replaced by a plain one of the same size.
+		int const pad = 2 * f.p.margin();
+		size_t const line = std::max(f.line, f.w + pad);
+		std::vector<pixel> src(line * f.h, pixel{}), dst(line * (f.h + pad)), pattern_buf{};
+		render::pattern pattern{};
+		if (f.pat_w > 0 && f.pat_h > 0) {
+			pattern_buf.assign(static_cast<size_t>(f.pat_w) * f.pat_h, f.p.col2);
+			pattern = { pattern_buf.data(), f.pat_w, f.pat_h, f.pat_ox, f.pat_oy, static_cast<size_t>(f.pat_w) };
+			f.p.img = &pattern;
+		}
+
+		// the best of the trials, and the time of each phase in it.
+		double best = std::numeric_limits<double>::infinity(), best_phases[std::size(phase_names)]{};
+		for (int i = 0; i < opt.repeat; i++) {
+			for (int y = 0; y < f.h; y++) {
+				for (int x = 0; x < f.w; x++) src[y * line + x].a = f.alpha[y * static_cast<size_t>(f.w) + x];
+			}
+			double phases[std::size(phase_names)]{};
+			MultiThread::timings = phases;
+			auto const t0 = std::chrono::steady_clock::now();
+			// in place when there's no margin, as the filter does.
+			render::compose(f.p, src.data(), f.w, f.h, line, pad > 0 ? dst.data() : src.data(), line);
+			double const sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			MultiThread::timings = nullptr;
+			if (sec < best) {
+				best = sec;
+				std::copy(std::begin(phases), std::end(phases), best_phases);
+			}
+		}
+
+		std::wprintf(L"%ls: %dx%d, captured %.3f ms, replayed %.3f ms (best of %d)\n",
+			path.filename().c_str(), f.w, f.h, f.seconds * 1e3, best * 1e3, opt.repeat);
+		double rest = best;
+		for (size_t i = 0; i < std::size(phase_names); i++) {
+			if (best_phases[i] <= 0) continue;
+			std::wprintf(L"  %-8ls %9.3f ms\n", phase_names[i], best_phases[i] * 1e3);
+			rest -= best_phases[i];
+		}
+		std::wprintf(L"  %-8ls %9.3f ms\n", L"other", std::max(rest, 0.0) * 1e3);
+	}
+	std::wprintf(L"%zu captures, %d threads, %hs\n", opt.inputs.size(), multi_thread.num_threads(),
+		kernels::isa_names[static_cast<size_t>(kernels::active_isa)]);
+	return failed > 0 ? 2 : 0;
+}
+
+
+////////////////////////////////
+// フレームの処理．
+////////////////////////////////
+// a frame on its way through decoding, drawing and encoding.
+struct frame {
+	int w = 0, h = 0;
+	pixel const* src = nullptr;
+	pixel* dst = nullptr;
+	std::vector<pixel> src_buf, dst_buf;
+	image_io::mapped_file::view in, out;
+
+	// the key points found while decoding, so compose() needn't scan the frame again.
+	std::vector<int> heap;
+	std::optional<convex_closure::hull> hull;
+};
+
+int wmain(int argc, wchar_t* argv[])
+{
+	options opt{};
+	if (!parse(opt, argc, argv)) {
+		std::fputws(usage, stderr);
+		return 1;
+	}
+
+	if (FAILED(::CoInitializeEx(nullptr, COINIT_MULTITHREADED)) || !image_io::startup()) {
+		std::fputws(L"failed to initialize Windows Imaging Component.\n", stderr);
+		return 1;
+	}
+	multi_thread.init_standalone(opt.threads);
+	// nothing is drawn yet, so it can afford to measure here.
+	if (!calibration::ensure()) calibration::run();
+	kernels::init();
+	if (opt.replay) {
+		int const ret = replay(opt);
+		::CoUninitialize();
+		return ret;
+	}
+
+	// the parameters, converted as the filter does.
+	auto const track = [](double val, int den, int min, int max) {
+		return std::clamp(static_cast<int>(std::lround(val * den)), min, max);
+	};
+	int const
+		margin = track(opt.margin, 1, 0, 500), stroke = track(opt.stroke, 1, 0, 500),
+		transp = track(opt.transp, 10, 0, 1000), f_transp = track(opt.f_transp, 10, 0, 1000),
+		threshold = track(opt.threshold, 10, 0, 1000),
+		img_x = track(opt.img_x, 1, -4000, 4000), img_y = track(opt.img_y, 1, -4000, 4000);
+	auto const rgb = [](uint32_t c) {
+		return render::fromRGB(static_cast<uint8_t>(c >> 16), static_cast<uint8_t>(c >> 8), static_cast<uint8_t>(c));
+	};
+	render::params p{
+		.extend = margin, .stroke = stroke,
+		.feather = track(opt.feather, 1, 0, 500), .gap = track(opt.gap, 1, 0, 100),
+		.alpha = max_alpha * (1000 - transp) / 1000, .f_alpha = max_alpha * (1000 - f_transp) / 1000,
+		.threshold = static_cast<render::i16>((threshold * (max_alpha - 1)) / 1000),
+		.draft = opt.draft, .antialias = !opt.draft && opt.antialias, .separate = opt.separate,
+		.round = opt.round,
+		.gradient = opt.gradient,
+		.angle = static_cast<float>(track(opt.angle, 10, -3600, 3600)) / 10,
+		.simplify = static_cast<float>(track(opt.simplify, 10, 0, 500)) / 10,
+		.field = track(opt.field, 1, 0, 500),
+		.concave = track(opt.concave, 1, 0, 1000),
+		.shape = opt.shape,
+		.col = rgb(opt.color), .col2 = rgb(opt.color2),
+		.img = nullptr,
+	};
+	int const pad = 2 * p.margin();
+
+	// the pattern image, repeated from the top-left corner of the original image.
+	std::vector<pixel> pattern_buf{};
+	render::pattern pattern{};
+	if (!opt.pattern.empty()) {
+		std::vector<uint8_t> rgba{};
+		int w, h;
+		if (!image_io::load_image(opt.pattern.c_str(), rgba, w, h) || w <= 0 || h <= 0) {
+			std::fwprintf(stderr, L"failed to load the pattern: %ls\n", opt.pattern.c_str());
+			return 1;
+		}
+		pattern_buf.resize(static_cast<size_t>(w) * h);
+		image_io::from_rgba(pattern_buf.data(), rgba.data(), pattern_buf.size());
+		int ox = (-img_x - p.margin()) % w, oy = (-img_y - p.margin()) % h;
+		if (ox < 0) ox += w; if (oy < 0) oy += h;
+		pattern = { pattern_buf.data(), w, h, ox, oy, static_cast<size_t>(w) };
+		p.img = &pattern;
+	}
+
+	// how frames are read and written.
+	int num_frames = 0, first_w = 0, first_h = 0;
+	image_io::mapped_file in_file{}, out_file{};
+	size_t const px_bytes = opt.raw_rgba ? 4 : sizeof(pixel);
+	size_t const in_bytes = px_bytes * opt.raw_w * opt.raw_h, out_bytes = px_bytes * (opt.raw_w + pad) * (opt.raw_h + pad);
+	auto const out_path = [&](int i) {
+		return (opt.output / opt.inputs[i].filename()).replace_extension(L".png");
+	};
+	if (!opt.raw.empty()) {
+		if (!in_file.open(opt.raw.c_str())) {
+			std::fwprintf(stderr, L"failed to open: %ls\n", opt.raw.c_str());
+			return 1;
+		}
+		num_frames = static_cast<int>(in_file.size() / in_bytes);
+		first_w = opt.raw_w; first_h = opt.raw_h;
+		if (!out_file.create(opt.output.c_str(), static_cast<uint64_t>(out_bytes) * num_frames)) {
+			std::fwprintf(stderr, L"failed to create: %ls\n", opt.output.c_str());
+			return 1;
+		}
+	}
+	else {
+		num_frames = static_cast<int>(opt.inputs.size());
+		std::error_code ec;
+		fs::create_directories(opt.output, ec);
+		if (!image_io::image_size(opt.inputs[0].c_str(), first_w, first_h)) first_w = first_h = 0;
+	}
+	if (num_frames <= 0) {
+		std::fputws(L"no frames to process.\n", stderr);
+		return 1;
+	}
+
+	// decodes the lines of a frame into `src` in bands by `decode_lines(y, count)`, and finds the shape
+	// from each band while it's still in the cache, on this thread beside the drawing of the previous frame.
+	// compose() scans the pixels itself in the draft mode, or when it needs more than the convex closure.
+	bool const find_early = p.alpha > 0 && !p.draft && !p.separate && p.concave <= 0;
+	auto const scan = [&](frame& f, pixel const* src, auto&& decode_lines) {
+		constexpr int band_h = 64;
+		std::optional<convex_closure::hull_builder> builder{};
+		if (find_early) {
+			int const dst_h = f.h + pad;
+			f.heap.resize(std::max(f.heap.size(), convex_closure::hull::heap_size(dst_h) / sizeof(int)));
+			builder.emplace(f.hull.emplace(f.heap.data(), dst_h), f.w, f.h);
+		}
+		bool const was_serial = std::exchange(MultiThread::serial, true);
+		for (int y = 0; y < f.h; y += band_h) {
+			int const count = std::min(band_h, f.h - y);
+			decode_lines(y, count);
+			if (builder) builder->add_lines<4>(&src[y * f.w].a, count, 4 * f.w, p.threshold);
+		}
+		MultiThread::serial = was_serial;
+		if (builder && !builder->finish()) f.hull.reset();
+	};
+	auto const decode = [&](int i, frame& f) -> bool {
+		f.hull.reset();
+		if (opt.raw.empty()) {
+			std::vector<uint8_t> rgba{};
+			if (!image_io::load_image(opt.inputs[i].c_str(), rgba, f.w, f.h)) return false;
+			f.src_buf.resize(static_cast<size_t>(f.w) * f.h);
+			scan(f, f.src_buf.data(), [&](int y, int count) {
+				size_t const at = static_cast<size_t>(y) * f.w;
+				image_io::from_rgba(f.src_buf.data() + at, rgba.data() + 4 * at, static_cast<size_t>(count) * f.w);
+			});
+		}
+		else {
+			f.w = opt.raw_w; f.h = opt.raw_h;
+			f.in = in_file.map(static_cast<uint64_t>(in_bytes) * i, in_bytes);
+			if (!f.in) return false;
+			if (opt.raw_rgba) {
+				f.src_buf.resize(static_cast<size_t>(f.w) * f.h);
+				scan(f, f.src_buf.data(), [&](int y, int count) {
+					size_t const at = static_cast<size_t>(y) * f.w;
+					image_io::from_rgba(f.src_buf.data() + at, f.in.data() + 4 * at, static_cast<size_t>(count) * f.w);
+				});
+				f.in = {};
+			}
+			else {
+				// draw straight from the input into the output, both mapped.
+				f.out = out_file.map(static_cast<uint64_t>(out_bytes) * i, out_bytes);
+				if (!f.out) return false;
+				f.dst = reinterpret_cast<pixel*>(f.out.data());
+				auto const in = reinterpret_cast<pixel const*>(f.in.data());
+				if (pad > 0) {
+					f.src = in;
+					scan(f, f.src, [](int, int) {});
+				}
+				else {
+					f.src = f.dst;
+					scan(f, f.src, [&](int y, int count) {
+						size_t const at = static_cast<size_t>(y) * f.w;
+						std::memcpy(f.dst + at, in + at, sizeof(pixel) * count * f.w);
+					});
+				}
+				return true;
+			}
+		}
+
+		f.src = f.src_buf.data();
+		if (pad > 0) {
+			f.dst_buf.resize(static_cast<size_t>(f.w + pad) * (f.h + pad));
+			f.dst = f.dst_buf.data();
+		}
+		else f.dst = f.src_buf.data();
+		return true;
+	};
+	auto const encode = [&](int i, frame& f) -> bool {
+		size_t const n = static_cast<size_t>(f.w + pad) * (f.h + pad);
+		bool ok = true;
+		if (opt.raw.empty()) {
+			std::vector<uint8_t> rgba(4 * n);
+			image_io::to_rgba(rgba.data(), f.dst, n);
+			ok = image_io::save_png(out_path(i).c_str(), rgba.data(), f.w + pad, f.h + pad);
+		}
+		else if (opt.raw_rgba) {
+			f.out = out_file.map(static_cast<uint64_t>(out_bytes) * i, out_bytes);
+			if (f.out) image_io::to_rgba(f.out.data(), f.dst, n);
+			else ok = false;
+		}
+		f.in = {}; f.out = {};
+		return ok;
+	};
+
+	// whole frames go in parallel when a frame alone is too small to keep all the threads busy.
+	int const num_threads = multi_thread.num_threads();
+	int jobs = opt.jobs;
+	if (jobs <= 0) {
+		int64_t const work = static_cast<int64_t>(first_w + pad) * (first_h + pad);
+		jobs = work < static_cast<int64_t>(multi_thread.cutoff(work_phase::fill)) * num_threads ? num_threads : 1;
+	}
+	jobs = std::clamp(jobs, 1, num_frames);
+
+	// each job takes every `jobs`-th frame, reading the next and writing the previous
+	// while drawing the current one.
+	std::atomic<int> failed = 0;
+	std::atomic<int64_t> draw_ns = 0;
+	auto const run = [&](int job) {
+		MultiThread::serial = jobs > 1;
+		frame slots[3];
+		std::future<bool> reading, writing;
+		int prev = -1;
+		auto const report = [&](int i) {
+			failed++;
+			std::fwprintf(stderr, L"failed at frame %d%ls%ls\n", i, opt.raw.empty() ? L": " : L"",
+				opt.raw.empty() ? opt.inputs[i].c_str() : L"");
+		};
+
+		if (job < num_frames) reading = std::async(std::launch::async, decode, job, std::ref(slots[0]));
+		for (int i = job, k = 0; i < num_frames; i += jobs, k = (k + 1) % 3) {
+			auto& f = slots[k];
+			bool const ok = reading.get();
+			if (i + jobs < num_frames)
+				reading = std::async(std::launch::async, decode, i + jobs, std::ref(slots[(k + 1) % 3]));
+
+			if (ok) {
+				auto const t0 = std::chrono::steady_clock::now();
+				render::compose(p, f.src, f.w, f.h, f.w, f.dst, f.w + pad, f.hull ? &*f.hull : nullptr);
+				draw_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+			}
+			else report(i);
+
+			if (writing.valid() && !writing.get()) report(prev);
+			if (ok) writing = std::async(std::launch::async, encode, i, std::ref(f));
+			prev = i;
+		}
+		if (writing.valid() && !writing.get()) report(prev);
+	};
+
+	auto const t0 = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> threads{};
+		for (int j = 1; j < jobs; j++) threads.emplace_back(run, j);
+		run(0);
+	}
+	double const sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::wprintf(L"%d frames in %.3f s, %.2f fps (drawing %.2f ms/frame), %d jobs x %d threads, %hs\n",
+		num_frames, sec, num_frames / std::max(sec, 1e-9), draw_ns * 1e-6 / num_frames,
+		jobs, jobs > 1 ? 1 : num_threads, kernels::isa_names[static_cast<size_t>(kernels::active_isa)]);
+	::CoUninitialize();
+	return failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,178 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <type_traits>
+
+#include "multi_thread.hpp"
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 離れた部分ごとの凸包．
+////////////////////////////////
+namespace convex_closure
+{
+	// groups the non-transparent pixels into clusters, where pixels at most `gap` pixels apart,
+	// both horizontally and vertically, belong to the same one.
+	class clusters {
+		// horizontal runs of non-transparent pixels, ranging [x0, x1) on the line y.
+		struct run { int x0, x1, y; };
+		std::vector<run> runs;
+
+		// indices of the runs sorted by the clusters, and then by the lines.
+		// runs of the i-th cluster are listed from order[head[i]] to order[head[i + 1] - 1].
+		std::vector<int> order, head{ 0 };
+		int obj_w = 0, obj_h = 0;
+
+	public:
+		// scans the pixels whose alpha exceeds `threshold`, and returns the number of the clusters.
+		template<size_t src_step, class src_t>
+		int scan(src_t const* src_buf, int obj_w, int obj_h, size_t src_stride,
+			std::type_identity_t<src_t> threshold, int gap)
+		{
+			this->obj_w = obj_w; this->obj_h = obj_h;
+			runs.clear();
+
+			// collect runs on each line, merging those separated by small gaps.
+			// each thread takes a contiguous block of lines, so the runs get sorted by lines when concatenated.
+			for (auto& part : multi_thread(work_phase::scan, obj_h * obj_w, [&](int thread_id, int thread_num) {
+				std::vector<run> part;
+				int const y0 = obj_h * thread_id / thread_num, y1 = obj_h * (thread_id + 1) / thread_num;
+				for (int y = y0; y < y1; y++) {
+					auto const line = src_buf + y * src_stride;
+					for (int x = 0; x < obj_w;) {
+						for (; x < obj_w && !(line[x * src_step] > threshold); x++);
+						if (x >= obj_w) break;
+						int const x0 = x;
+						for (; x < obj_w && line[x * src_step] > threshold; x++);
+
+						if (!part.empty() && part.back().y == y && x0 - part.back().x1 <= gap)
+							part.back().x1 = x;
+						else part.push_back({ x0, x, y });
+					}
+				}
+				return part;
+			})) runs.insert(runs.end(), part.begin(), part.end());
+
+			int const count = static_cast<int>(runs.size());
+			std::vector<int> line_head(obj_h + 1, 0);
+			for (auto const& r : runs) line_head[r.y + 1]++;
+			std::partial_sum(line_head.begin(), line_head.end(), line_head.begin());
+
+			// connect runs on nearby lines by union-find.
+			std::vector<int> parent(count);
+			std::iota(parent.begin(), parent.end(), 0);
+			auto const root = [&](int i) {
+				while (parent[i] != i) i = parent[i] = parent[parent[i]];
+				return i;
+			};
+			for (int y = 1; y < obj_h; y++) {
+				for (int y2 = std::max(y - gap - 1, 0); y2 < y; y2++) {
+					int ia = line_head[y], ib = line_head[y2];
+					int const ea = line_head[y + 1], eb = line_head[y2 + 1];
+					while (ia < ea && ib < eb) {
+						auto const& a = runs[ia], & b = runs[ib];
+						if (b.x1 + gap < a.x0) ib++;
+						else if (a.x1 + gap < b.x0) ia++;
+						else {
+							// close enough.
+							if (int const ra = root(ia), rb = root(ib); ra != rb)
+								parent[std::max(ra, rb)] = std::min(ra, rb);
+							if (a.x1 < b.x1) ia++; else ib++;
+						}
+					}
+				}
+			}
+
+			// number the clusters, and sort the runs by them.
+			std::vector<int> label(count);
+			head.assign(1, 0);
+			for (int i = 0; i < count; i++) {
+				if (int const r = root(i); r == i) {
+					label[i] = static_cast<int>(head.size()) - 1;
+					head.push_back(0);
+				}
+				else label[i] = label[r];
+				head[label[i] + 1]++;
+			}
+			std::partial_sum(head.begin(), head.end(), head.begin());
+
+			order.resize(count);
+			std::vector<int> pos(head.begin(), head.end() - 1);
+			for (int i = 0; i < count; i++) order[pos[label[i]]++] = i;
+
+			return size();
+		}
+
+		// the clusters are numbered in the order of their top lines.
+		int size() const { return static_cast<int>(head.size()) - 1; }
+
+		// the bounding box of the i-th cluster, whose right and bottom are exclusive.
+		box bounds(int i) const
+		{
+			auto const begin = order.begin() + head[i], end = order.begin() + head[i + 1];
+			box b{ obj_w, runs[*begin].y, 0, runs[end[-1]].y + 1 };
+			for (auto p = begin; p != end; ++p) {
+				b.left = std::min(b.left, runs[*p].x0);
+				b.right = std::max(b.right, runs[*p].x1);
+			}
+			return b;
+		}
+
+		// finds the key points of the i-th cluster, as find_key_points() does for the entire object.
+		void find_key_points(hull& h, int i) const { find_key_points(h, i, { 0, 0, obj_w, obj_h }); }
+
+		// the same, as if the object were cropped to `b` that contains the cluster,
+		// so the key points are relative to its top-left corner, and the heap can be as small as for its height.
+		void find_key_points(hull& h, int i, box const& b) const
+		{
+			int const w = b.right - b.left, h_b = b.bottom - b.top;
+			auto const heap1 = h.heap1, heap1r = heap1 + h_b;
+			auto const begin = order.begin() + head[i], end = order.begin() + head[i + 1];
+
+			bound bd = bound::empty(w, h_b);
+			bd.top = runs[*begin].y - b.top; bd.btm = runs[end[-1]].y - b.top;
+			for (int y = bd.top; y <= bd.btm; y++) { heap1[y] = w; heap1r[y] = 0; }
+			for (auto p = begin; p != end; ++p) {
+				auto const& r = runs[*p];
+				int const y = r.y - b.top;
+				heap1[y] = std::min(heap1[y], r.x0 - b.left);
+				heap1r[y] = std::min(heap1r[y], ~(r.x1 - 1 - b.left));
+			}
+
+			for (int y = bd.top; y <= bd.btm; y++) {
+				if (int const x = heap1[y]; x <= bd.l_min) {
+					if (x < bd.l_min) {
+						bd.l_min = x;
+						bd.l_min_top = y;
+					}
+					bd.l_min_btm = y;
+				}
+				if (int const x = ~heap1r[y]; x >= bd.r_max) {
+					if (x > bd.r_max) {
+						bd.r_max = x;
+						bd.r_max_top = y;
+					}
+					bd.r_max_btm = y;
+				}
+			}
+
+			convex_closure::find_key_points(h, bd, h_b);
+		}
+	};
+}
@@ -0,0 +1,240 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "multi_thread.hpp"
+#include "kernels.hpp"
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 凹包の計算．
+////////////////////////////////
+namespace convex_closure
+{
+	// a shape tighter than the convex closure: the intersection of the spans of the pixels on each line
+	// and on each column, where the dents of the boundary up to `gap` pixels wide are bridged as the
+	// convex closure would. the signed distance from it is approximated by those along the lines and
+	// the columns, each corrected by the slope of the boundary.
+	struct concave {
+		// the signed distance at t along a line or a column is max(p0 - k0*t, k1*t - p1),
+		// for the near and the far sides. a line off the shape, `off` away from the nearest line on it,
+		// takes the span of that line with k0 = k1 = 1, and the distance is the hypotenuse of
+		// `off` and the one along the line beyond the span. `off` is zero for the lines on the shape.
+		struct sides {
+			float p0, k0, p1, k1, off;
+
+			// the distance at t, given e = max(p0 - k0*t, k1*t - p1).
+			float at(float e) const { return off > 0 ? std::sqrt(off * off + std::max(e, 0.0f) * std::max(e, 0.0f)) : e; }
+		};
+		std::vector<sides> rows, cols;
+		box bounds; // in the coordinates of the destination.
+
+		// finds the shape of the pixels whose alpha exceeds `threshold`, moved outward by `extend`
+		// along circles (or squares if not `round`), in the destination larger by `margin` on each side.
+		// returns false if there are no such pixels.
+		template<size_t src_step>
+		bool build(i16 const* src_buf, int obj_w, int obj_h, size_t src_stride, i16 threshold,
+			int margin, int extend, bool round, int gap)
+		{
+			int const dst_w = obj_w + 2 * margin, dst_h = obj_h + 2 * margin;
+			lo_r.resize(obj_h); hi_r.resize(obj_h); lo_c.resize(obj_w); hi_c.resize(obj_w);
+
+			// the left/right-most pixels on each line, with the end exclusive. empty if lo > hi.
+			multi_thread(work_phase::scan, obj_w * obj_h, [&](int thread_id, int thread_num) {
+				for (int y = thread_id; y < obj_h; y += thread_num) {
+					auto const line = src_buf + y * src_stride;
+					int l, r;
+					if constexpr (kernels::can_find<i16, src_step>) {
+						l = kernels::first_above<src_step>(line, obj_w, threshold);
+						r = l < obj_w ? kernels::last_above<src_step>(line, obj_w, threshold) : -1;
+					}
+					else {
+						for (l = 0; l < obj_w && line[l * src_step] <= threshold; l++);
+						for (r = obj_w - 1; r >= l && line[r * src_step] <= threshold; r--);
+					}
+					lo_r[y] = l; hi_r[y] = r + 1;
+				}
+			});
+			int l_min = obj_w, r_max = 0;
+			for (int y = 0; y < obj_h; y++) {
+				if (lo_r[y] >= hi_r[y]) continue;
+				l_min = std::min(l_min, lo_r[y]); r_max = std::max(r_max, hi_r[y]);
+			}
+			if (l_min >= r_max) return false;
+
+			// the top/bottom-most pixels on each column, looking only within the spans of the lines,
+			// in bands of columns so each thread goes down the lines.
+			multi_thread(work_phase::scan, obj_w * obj_h, [&](int thread_id, int thread_num) {
+				int const x0 = l_min + (r_max - l_min) * thread_id / thread_num,
+					x1 = l_min + (r_max - l_min) * (thread_id + 1) / thread_num;
+				for (int x = x0; x < x1; x++) { lo_c[x] = obj_h; hi_c[x] = 0; }
+				for (int y = 0; y < obj_h; y++) {
+					auto const line = src_buf + y * src_stride;
+					for (int x = std::max(x0, lo_r[y]), e = std::min(x1, hi_r[y]); x < e; x++) {
+						bool const hit = line[x * src_step] > threshold;
+						lo_c[x] = std::min(lo_c[x], hit ? y : obj_h);
+						hi_c[x] = std::max(hi_c[x], hit ? y + 1 : 0);
+					}
+				}
+			});
+			for (int x = 0; x < l_min; x++) { lo_c[x] = obj_h; hi_c[x] = 0; }
+			for (int x = r_max; x < obj_w; x++) { lo_c[x] = obj_h; hi_c[x] = 0; }
+
+			rows.resize(dst_h); cols.resize(dst_w);
+			bounds = { dst_w, dst_h, 0, 0 };
+			build_sides(lo_r, hi_r, obj_h, rows, margin, extend, round, gap, bounds.left, bounds.right);
+			build_sides(lo_c, hi_c, obj_w, cols, margin, extend, round, gap, bounds.top, bounds.bottom);
+			return true;
+		}
+
+	private:
+		struct point { int t; float x; };
+		std::vector<int> lo_r, hi_r, lo_c, hi_c;
+		std::vector<float> lo, hi;
+		std::vector<point> chain;
+
+		// turns the spans into the sides on each line of the destination.
+		void build_sides(std::vector<int> const& lo_s, std::vector<int> const& hi_s, int n_s,
+			std::vector<sides>& out, int margin, int extend, bool round, int gap, int& b_lo, int& b_hi)
+		{
+			constexpr float inf = std::numeric_limits<float>::infinity();
+			int const n = static_cast<int>(out.size());
+			lo.assign(n, inf); hi.assign(n, -inf);
+
+			// move outward by the pixels within `extend` lines.
+			multi_thread(work_phase::scan, n * (2 * extend + 1), [&](int thread_id, int thread_num) {
+				for (int i = thread_id; i < n; i += thread_num) {
+					for (int j = std::max(i - margin - extend, 0), j1 = std::min(i - margin + extend, n_s - 1); j <= j1; j++) {
+						if (lo_s[j] >= hi_s[j]) continue;
+						float const d = static_cast<float>(std::abs(j + margin - i)),
+							r = round ? std::sqrt(static_cast<float>(extend * extend) - d * d) : extend;
+						lo[i] = std::min(lo[i], lo_s[j] + margin - r);
+						hi[i] = std::max(hi[i], hi_s[j] + margin + r);
+					}
+				}
+			});
+
+			// bridge the dents as the convex closure does, but only across `gap` lines at most.
+			bridge(lo, n, gap, false);
+			bridge(hi, n, gap, true);
+
+			// the distance along the lines is scaled by the cosine of the slope,
+			// which is taken on the flatter side at the vertices.
+			constexpr auto cosine = [](float const* v, int i, int n) {
+				float s = inf;
+				if (i > 0 && std::isfinite(v[i - 1])) s = std::abs(v[i] - v[i - 1]);
+				if (i + 1 < n && std::isfinite(v[i + 1])) s = std::min(s, std::abs(v[i + 1] - v[i]));
+				return s < inf ? 1 / std::sqrt(1 + s * s) : 1.0f;
+			};
+			for (int i = 0; i < n; i++) {
+				if (lo[i] > hi[i]) continue;
+				float const k0 = cosine(lo.data(), i, n), k1 = cosine(hi.data(), i, n);
+				out[i] = { k0 * lo[i], k0, k1 * hi[i], k1, 0 };
+				b_lo = std::min(b_lo, static_cast<int>(std::floor(lo[i])));
+				b_hi = std::max(b_hi, static_cast<int>(std::ceil(hi[i])));
+			}
+
+			// lines off the shape, by the distance to the span of the nearest line on it,
+			// so the corners of the shape are rounded off as they should be.
+			for (int i = 0, prev = -1; i < n; i++) {
+				if (lo[i] <= hi[i]) prev = i;
+				else out[i] = prev >= 0 ? sides{ lo[prev], 1, hi[prev], 1, i - prev - 0.5f } : sides{ 0, 1, 0, 1, inf };
+			}
+			for (int i = n, next = -1; --i >= 0;) {
+				if (lo[i] <= hi[i]) next = i;
+				else if (next >= 0 && next - i - 0.5f < out[i].off)
+					out[i] = { lo[next], 1, hi[next], 1, next - i - 0.5f };
+			}
+		}
+
+		// replaces the values on the outer side by the convex closure of the lines, each a segment
+		// from its near edge to its far edge, where the points are bridged only if at most `gap` apart.
+		// the values are then taken at the centers of the lines. `flip` for the maximum side.
+		void bridge(std::vector<float>& v, int n, int gap, bool flip)
+		{
+			float const sign = flip ? -1.0f : 1.0f;
+			chain.clear();
+			auto const push = [&](int t, float x) {
+				if (!chain.empty() && chain.back().t == t) {
+					if (sign * x >= sign * chain.back().x) return;
+					chain.pop_back();
+				}
+				while (chain.size() >= 2) {
+					auto const& a = chain[chain.size() - 2], & b = chain.back();
+					// keep the last point if it's strictly outside, or too far to bridge.
+					if (t - a.t > gap || sign * (b.x - a.x) * (t - a.t) < sign * (x - a.x) * (b.t - a.t)) break;
+					chain.pop_back();
+				}
+				chain.push_back({ t, x });
+			};
+			for (int i = 0; i < n; i++) {
+				if (!std::isfinite(v[i])) continue;
+				push(i, v[i]); push(i + 1, v[i]);
+			}
+			for (size_t j = 1; j < chain.size(); j++) {
+				auto const a = chain[j - 1], b = chain[j];
+				if (b.t - a.t > gap) continue;
+				for (int i = a.t; i < b.t; i++)
+					v[i] = a.x + (b.x - a.x) * (i + 0.5f - a.t) / (b.t - a.t);
+			}
+		}
+	};
+
+	// makes a function that evaluates the signed distance d from the shape at the center of each pixel
+	// on the given line, which is negative inside, and writes fn(d) into the alpha channel,
+	// where fn() is called only for d_in < d < d_out.
+	// the shape must outlive the returned function.
+	template<size_t dst_step>
+	auto concave_rasterizer(concave const& sh, i16* dst_buf, int dst_w, size_t dst_stride,
+		float d_in, float d_out, auto fn)
+	{
+		i16 const v_in = fn(d_in), v_out = fn(d_out);
+		return [=, &sh](int y) {
+			// the distances on the line, computed apart from fn() so the loop can be vectorized.
+			static thread_local std::vector<float> dist{};
+			dist.resize(std::max<size_t>(dist.size(), dst_w));
+
+			i16* const dst = dst_buf + y * dst_stride;
+			auto const r = sh.rows[y];
+			float const cy = y + 0.5f;
+
+			// the pixels outside on the line alone are left out.
+			int x0 = 0, x1 = 0;
+			if (r.off < d_out) {
+				float const reach = r.off > 0 ? std::sqrt(d_out * d_out - r.off * r.off) : d_out;
+				x0 = std::clamp(static_cast<int>(std::floor((r.p0 - reach) / r.k0 - 0.5f)), 0, dst_w);
+				x1 = std::clamp(static_cast<int>(std::ceil((r.p1 + reach) / r.k1 - 0.5f)) + 1, x0, dst_w);
+			}
+			for (int x = 0; x < x0; x++) dst[x * dst_step] = v_out;
+			for (int x = x1; x < dst_w; x++) dst[x * dst_step] = v_out;
+
+			auto const* const cols = sh.cols.data();
+			float* const d = dist.data();
+			for (int x = x0; x < x1; x++) {
+				auto const& c = cols[x];
+				float const cx = x + 0.5f;
+				d[x] = std::max(r.at(std::max(r.p0 - r.k0 * cx, r.k1 * cx - r.p1)), c.at(std::max(c.p0 - c.k0 * cy, c.k1 * cy - c.p1)));
+			}
+			for (int x = x0; x < x1; x++)
+				dst[x * dst_step] = d[x] <= d_in ? v_in : d[x] >= d_out ? v_out : fn(d[x]);
+		};
+	}
+}
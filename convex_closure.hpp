@@ -0,0 +1,966 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <tuple>
+#include <type_traits>
+
+#include "multi_thread.hpp"
+#include "kernels.hpp"
+
+
+////////////////////////////////
+// 凸包の計算．
+////////////////////////////////
+namespace convex_closure
+{
+	using i16 = int16_t;
+	constexpr int log2_max_alpha = 12, max_alpha = 1 << log2_max_alpha;
+
+	// objects of at least this size are scanned coarse-to-fine, first every `coarse_step`-th line.
+	// in the draft mode, the lines other than those are skipped.
+	constexpr int coarse_step = 8, coarse_min_size = 1 << 8;
+
+	// how the coverage is written into the destination.
+	enum class write_mode {
+		overwrite,	// replaces the alpha, clearing the outside of the shape.
+		subtract,	// subtracts from the existing alpha.
+		combine,	// takes the maximum with the existing alpha.
+	};
+
+	// vertices of the desired convex closure,
+	// which is a polygon as the number of pixels is finite.
+	struct key_points {
+		int top, btm;
+		int* x_map;
+		int* key_pts;
+		int count;
+		constexpr auto peek(int i) const {
+			return std::pair{ key_pts[2 * (count - i)], key_pts[2 * (count - i) + 1] };
+		}
+		constexpr void push(int x, int y) {
+			key_pts[2 * count] = x; key_pts[2 * count + 1] = y;
+			count++;
+		}
+		constexpr void pop() { count--; }
+		constexpr key_points(int top, int btm, int* x_map, int* key_pts)
+			: top{ top }, btm{ btm }, x_map{ x_map }, key_pts{ key_pts }, count{ 1 } {
+			key_pts[0] = x_map[top]; key_pts[1] = top;
+		}
+	#pragma warning ( suppress : 26495 ) // member variables intentionally left uninitialized.
+		constexpr key_points() {}
+	};
+
+	// the state of the calculation shared among the phases below.
+	struct hull {
+		key_points LT, LB, RT, RB;
+		int* heap1, * heap2, * heap3, * heap4;
+
+		// size of the working memory in bytes for the object of height `dst_h`, including the margin.
+		constexpr static size_t heap_size(int dst_h) { return 4 * 2 * (dst_h + 1) * sizeof(int); }
+		hull(void* heap, int dst_h)
+			: heap1{ reinterpret_cast<int*>(heap) }
+			, heap2{ heap1 + 2 * (dst_h + 1) }
+			, heap3{ heap2 + 2 * (dst_h + 1) }
+			, heap4{ heap3 + 2 * (dst_h + 1) } {}
+
+		// copies the whole state into another hull of the same size,
+		// so that the polygon can be extended more than once.
+		void copy_to(hull& h) const
+		{
+			std::memcpy(h.heap1, heap1, (heap4 - heap1 + (heap2 - heap1)) * sizeof(int));
+			auto const rebase = [&](int* p) { return h.heap1 + (p - heap1); };
+			for (auto [src, dst] : { std::pair{ &LT, &h.LT }, { &LB, &h.LB }, { &RT, &h.RT }, { &RB, &h.RB } }) {
+				*dst = *src;
+				dst->x_map = rebase(src->x_map);
+				dst->key_pts = rebase(src->key_pts);
+			}
+		}
+	};
+
+	// the range of the non-transparent pixels, and where the left/right-most ones are.
+	struct bound {
+		int top, btm;
+		int l_min, l_min_top, l_min_btm;
+		int r_max, r_max_top, r_max_btm;
+
+		constexpr static bound empty(int obj_w, int obj_h) {
+			return {
+				obj_h, -1,
+				obj_w, obj_h, -1,
+				-1, obj_h, -1,
+			};
+		}
+	};
+
+	// identifies the key points from the left/right-most non-transparent pixels on each line,
+	// stored in `heap1` and in `heap1 + obj_h` with x flipped, within the range of `bd`.
+	inline void find_key_points(hull& h, bound const& bd, int obj_h);
+
+	// finds the key points of the convex closure of the pixels whose alpha exceeds `threshold`.
+	// returns false if there are no such pixels.
+	template<size_t src_step, class src_t>
+	bool find_key_points(hull& h, src_t const* src_buf, int obj_w, int obj_h, size_t src_stride,
+		std::type_identity_t<src_t> threshold, bool draft)
+	{
+		// threshold is used as: alpha > threshold / alpha <= threshold.
+		auto const heap1 = h.heap1, heap2 = h.heap2;
+
+		// first, traverse pixels for rough bounding.
+		bound bd = bound::empty(obj_w, obj_h);
+		{
+			auto const heap1r = heap1 + obj_h;
+			bound const bound_empty = bd;
+
+			// alpha channels of PixelYCA, packed 8-bit alpha and RGBA8 are searched by the vectorized kernels.
+			constexpr bool use_kernels = kernels::can_find<src_t, src_step>;
+
+			// searches the line y for the left/right-most non-transparent pixels,
+			// looking only at x < lim_l from the left, and at x > lim_r from the right.
+			// entries of heap1/heap1r are left "inside" (obj_w / ~(-1)) if not found.
+			auto const scan_line = [&](bound& bd, int y, int lim_l, int lim_r) {
+				auto const line = src_buf + y * src_stride;
+				bool found = false;
+
+				int x = 0;
+				if constexpr (use_kernels) x = kernels::first_above<src_step>(line, std::max(lim_l, 0), threshold);
+				else for (auto p = line; x < lim_l; x++, p += src_step) {
+					if (*p > threshold) break;
+				}
+				if (x < lim_l) {
+					found = true;
+					heap1[y] = x;
+					if (x <= bd.l_min) {
+						if (x < bd.l_min) {
+							bd.l_min = x;
+							bd.l_min_top = y;
+						}
+						bd.l_min_btm = y;
+					}
+					lim_r = std::max(lim_r, x - 1);
+				}
+				else {
+					heap1[y] = obj_w;
+					if (lim_l >= obj_w) {
+						// the entire line is transparent.
+						heap1r[y] = 0;
+						return;
+					}
+				}
+
+				x = obj_w - 1;
+				if constexpr (use_kernels)
+					x = lim_r + 1 + kernels::last_above<src_step>(line + (lim_r + 1) * src_step, std::max(x - lim_r, 0), threshold);
+				else for (auto p = line + x * src_step; x > lim_r; x--, p -= src_step) {
+					if (*p > threshold) break;
+				}
+				if (x > lim_r) {
+					found = true;
+					heap1r[y] = ~x; // "flip" so subsequent comparison will simplify.
+					if (x >= bd.r_max) {
+						if (x > bd.r_max) {
+							bd.r_max = x;
+							bd.r_max_top = y;
+						}
+						bd.r_max_btm = y;
+					}
+				}
+				else heap1r[y] = 0;
+
+				if (found) {
+					if (bd.top > y) bd.top = y;
+					if (bd.btm < y) bd.btm = y;
+				}
+			};
+			auto const scan_every = [&](int step) {
+				return multi_thread(work_phase::scan, (obj_h + step - 1) / step * obj_w, [&](int thread_id, int thread_num) -> bound {
+					bound bd = bound_empty;
+					for (int y = thread_id * step; y < obj_h; y += thread_num * step)
+						scan_line(bd, y, obj_w, -1);
+					return bd;
+				});
+			};
+
+			// combine the found boundings.
+			auto const combine = [&](auto const& bounds) {
+				for (auto& bd_i : bounds) {
+					if (bd_i.top > bd_i.btm) continue;
+					bd.top = std::min(bd.top, bd_i.top);
+					bd.btm = std::max(bd.btm, bd_i.btm);
+
+					if (bd.l_min == bd_i.l_min) {
+						bd.l_min_top = std::min(bd.l_min_top, bd_i.l_min_top);
+						bd.l_min_btm = std::max(bd.l_min_btm, bd_i.l_min_btm);
+					}
+					else if (bd.l_min > bd_i.l_min) {
+						bd.l_min = bd_i.l_min;
+						bd.l_min_top = bd_i.l_min_top;
+						bd.l_min_btm = bd_i.l_min_btm;
+					}
+
+					if (bd.r_max == bd_i.r_max) {
+						bd.r_max_top = std::min(bd.r_max_top, bd_i.r_max_top);
+						bd.r_max_btm = std::max(bd.r_max_btm, bd_i.r_max_btm);
+					}
+					else if (bd.r_max < bd_i.r_max) {
+						bd.r_max = bd_i.r_max;
+						bd.r_max_top = bd_i.r_max_top;
+						bd.r_max_btm = bd_i.r_max_btm;
+					}
+				}
+			};
+
+			if (obj_w < coarse_min_size || obj_h < coarse_min_size)
+				// small enough to simply scan every line.
+				combine(scan_every(1));
+			else {
+				// coarse-to-fine: scan every `coarse_step`-th line first.
+				combine(scan_every(coarse_step));
+				if (draft) {
+					// mark the rest of lines as if they were transparent.
+					for (int y = 0; y < obj_h; y++) {
+						if (y % coarse_step == 0) continue;
+						heap1[y] = obj_w; heap1r[y] = 0;
+					}
+				}
+				else {
+					// the convex closure of the pixels found so far is an inner bound of the final result,
+					// and no pixel inside it can be a key point. so the rest of lines need scanning
+					// only up to its left/right chains, which are stored in heap2 (not in use yet).
+					auto const build_chain = [&](int const* x_map, int* chain) {
+						int n = 0;
+						for (int y = bd.top; y <= bd.btm; y += coarse_step) {
+							if (heap1[y] >= obj_w) continue;
+							int const x = x_map[y];
+							while (n >= 2) {
+								int const xa = chain[2 * n - 4], ya = chain[2 * n - 3],
+									xb = chain[2 * n - 2], yb = chain[2 * n - 1];
+								// keep the last point only if it's strictly outside.
+								if ((xb - xa) * (y - ya) < (x - xa) * (yb - ya)) break;
+								n--;
+							}
+							chain[2 * n] = x; chain[2 * n + 1] = y;
+							n++;
+						}
+						return n;
+					};
+					int* const chain_l = heap2;
+					int* const chain_r = chain_l + 2 * build_chain(heap1, chain_l);
+					build_chain(heap1r, chain_r);
+
+					// the least integer not less than the chain at y, assuming y only increases.
+					constexpr auto chain_limit = [](int const*& chain, int y) {
+						while (chain[3] < y) chain += 2;
+						int const dx = chain[2] - chain[0], dy = chain[3] - chain[1],
+							num = dx * (y - chain[1]);
+						return chain[0] + (num >= 0 ? (num + dy - 1) / dy : -(-num / dy));
+					};
+					combine(multi_thread(work_phase::scan, obj_h * obj_w, [&](int thread_id, int thread_num) -> bound {
+						bound bd_i = bound_empty;
+						int const* cl = chain_l, * cr = chain_r;
+						for (int y = thread_id; y < obj_h; y += thread_num) {
+							if (y % coarse_step == 0) continue; // already scanned.
+							if (y < bd.top || y > bd.btm) scan_line(bd_i, y, obj_w, -1);
+							else scan_line(bd_i, y, chain_limit(cl, y), ~chain_limit(cr, y));
+						}
+						return bd_i;
+					}));
+				}
+			}
+
+		}
+
+		// found to be empty.
+		if (bd.top > bd.btm) return false;
+
+		find_key_points(h, bd, obj_h);
+		return true;
+	}
+
+	inline void find_key_points(hull& h, bound const& bd, int obj_h)
+	{
+		auto& LT = h.LT, & LB = h.LB, & RT = h.RT, & RB = h.RB;
+		auto const heap1 = h.heap1, heap1r = heap1 + obj_h, heap3 = h.heap3, heap4 = h.heap4;
+
+		// summary.
+		LT = { bd.top, bd.l_min_top, heap1,  heap3 };
+		LB = { bd.l_min_btm, bd.btm, heap1,  heap3 + 2 * (bd.l_min_top - bd.top + 1) };
+		RT = { bd.top, bd.r_max_top, heap1r, heap4 };
+		RB = { bd.r_max_btm, bd.btm, heap1r, heap4 + 2 * (bd.r_max_top - bd.top + 1) };
+
+		// identify "key points" by Graham scan (https://en.wikipedia.org/wiki/Graham_scan).
+		multi_thread(work_phase::graham, 2 * (LB.btm - LT.top + 1), [&](int thread_id, int thread_num) {
+			// parallel loop up to four threads.
+			for (int i = thread_id; i < 4; i += thread_num) {
+				auto const quad = [&]{
+					switch (i) {
+					case 0: return &LT;
+					case 1: return &LB;
+					case 2: return &RT;
+					case 3: return &RB;
+					default: std::unreachable();
+					}
+				}();
+
+				if (int const y_btm = quad->btm;
+					quad->top < y_btm) {
+					int const x_btm = quad->x_map[y_btm];
+
+					auto [x1, y1] = quad->peek(1);
+					int diff_x = x_btm - x1, diff_y = y_btm - y1, cmp_base = x1 * diff_y;
+					int y = y1 + 1; int const* x_map = quad->x_map + y;
+					for (; y < y_btm; y++, x_map++) {
+						int const x = *x_map;
+						cmp_base += diff_x;
+						if (cmp_base > x * diff_y) {
+							while (quad->count > 1) {
+								auto const [x0, y0] = quad->peek(2);
+								int const dx1 = x1 - x0, dy1 = y1 - y0,
+									dx = x - x1, dy = y - y1;
+								if (dx * dy1 > dx1 * dy) break;
+								quad->pop();
+								x1 = x0; y1 = y0;
+							}
+							quad->push(x, y);
+							x1 = x; y1 = y;
+							diff_x = x_btm - x; diff_y = y_btm - y; cmp_base = x * diff_y;
+						}
+					}
+					quad->push(x_btm, y_btm);
+				}
+			}
+		});
+	}
+
+	// reduces the key points by replacing pairs of adjacent ones with the crossing point of the edges around them,
+	// which only enlarges the polygon, by at most `tolerance` pixels.
+	// the bounds hold only before extension; extend_key_points() mitres the corners, which have changed,
+	// so the extended polygon may fall short of the original one extended, by about a pixel, or go beyond the tolerance.
+	// call this between find_key_points() and extend_key_points(). does nothing if `tolerance` isn't positive.
+	inline void simplify_key_points(hull& h, float tolerance)
+	{
+		if (!(tolerance > 0)) return;
+		auto& LT = h.LT, & LB = h.LB, & RT = h.RT, & RB = h.RB;
+
+		// keep the original key points in heap1 and heap2, which are free until extend_key_points().
+		std::memcpy(h.heap1, h.heap3, (h.heap4 - h.heap3) * sizeof(int));
+		std::memcpy(h.heap2, h.heap4, (h.heap4 - h.heap3) * sizeof(int));
+
+		multi_thread(work_phase::extend, LT.count + LB.count + RT.count + RB.count, [&](int thread_id, int thread_num) {
+			for (int i = thread_id; i < 4; i += thread_num) {
+				auto const [quad, org] = [&] {
+					switch (i) {
+					case 0: return std::pair{ &LT, h.heap1 + (LT.key_pts - h.heap3) };
+					case 1: return std::pair{ &LB, h.heap1 + (LB.key_pts - h.heap3) };
+					case 2: return std::pair{ &RT, h.heap2 + (RT.key_pts - h.heap4) };
+					case 3: return std::pair{ &RB, h.heap2 + (RB.key_pts - h.heap4) };
+					default: std::unreachable();
+					}
+				}();
+				int const n = quad->count;
+				if (n < 4) continue;
+
+				// every chain goes downward with the inside on its right, x flipped for RT/RB,
+				// so the polygon is convex where cross() of the consecutive edges is not positive.
+				// the outside is toward -x and -y for LT/RT, and toward -x and +y for LB/RB.
+				bool const lower = i % 2 != 0;
+				constexpr auto cross = [](int ax, int ay, int bx, int by) { return ax * by - ay * bx; };
+
+				// squared distance from the point to the original chain.
+				auto const dist2 = [&](int px, int py) {
+					float d2 = std::numeric_limits<float>::infinity();
+					for (int j = 0; j + 1 < n; j++) {
+						float const x0 = static_cast<float>(org[2 * j]), y0 = static_cast<float>(org[2 * j + 1]),
+							dx = org[2 * j + 2] - x0, dy = org[2 * j + 3] - y0,
+							ex = px - x0, ey = py - y0, l2 = dx * dx + dy * dy,
+							t = std::clamp((ex * dx + ey * dy) / l2, 0.0f, 1.0f);
+						d2 = std::min(d2, (ex - t * dx) * (ex - t * dx) + (ey - t * dy) * (ey - t * dy));
+					}
+					return d2;
+				};
+
+				// tries to replace the 2nd and 3rd last of the simplified chain `pts`,
+				// with the 4th last and the last kept and `next` following them.
+				int* const pts = quad->key_pts;
+				auto const try_merge = [&](int m, int const* next) {
+					int const* const a = pts + 2 * (m - 4), * const b = pts + 2 * (m - 1);
+					int const* const p = a + 2, * const q = b - 2;
+
+					// the crossing point of the lines a-p and q-b, rounded outward.
+					int const d1x = p[0] - a[0], d1y = p[1] - a[1], d2x = b[0] - q[0], d2y = b[1] - q[1],
+						den = cross(d1x, d1y, d2x, d2y);
+					if (den >= 0) return false;
+					double const t = static_cast<double>(cross(q[0] - a[0], q[1] - a[1], d2x, d2y)) / den,
+						cx = a[0] + t * d1x, cy = a[1] + t * d1y;
+					int const x = static_cast<int>(std::floor(cx)),
+						y = static_cast<int>(lower ? std::ceil(cy) : std::floor(cy));
+
+					// should be between a and b, on a line of its own, keeping the chain monotonic,
+					if (y <= a[1] || y >= b[1] || x < std::min(a[0], b[0]) || x > std::max(a[0], b[0])) return false;
+					// keep the polygon convex,
+					if (m > 4 && cross(a[0] - a[-2], a[1] - a[-1], x - a[0], y - a[1]) > 0) return false;
+					if (cross(x - a[0], y - a[1], b[0] - x, b[1] - y) > 0) return false;
+					if (next != nullptr && cross(b[0] - x, b[1] - y, next[0] - b[0], next[1] - b[1]) > 0) return false;
+					// contain all the original points,
+					for (int j = 0; j < n; j++) {
+						int const ox = org[2 * j], oy = org[2 * j + 1];
+						if (cross(x - a[0], y - a[1], ox - a[0], oy - a[1]) > 0 ||
+							cross(b[0] - x, b[1] - y, ox - x, oy - y) > 0) return false;
+					}
+					// and stay within the tolerance.
+					if (dist2(x, y) > tolerance * tolerance) return false;
+
+					pts[2 * (m - 3)] = x; pts[2 * (m - 3) + 1] = y;
+					pts[2 * (m - 2)] = b[0]; pts[2 * (m - 2) + 1] = b[1];
+					return true;
+				};
+
+				// the simplified chain is built in place, never getting ahead of the original.
+				int m = 2;
+				for (int j = 2; j < n; j++) {
+					pts[2 * m] = org[2 * j]; pts[2 * m + 1] = org[2 * j + 1]; m++;
+					int const* const next = j + 1 < n ? org + 2 * (j + 1) : nullptr;
+					while (m >= 4 && try_merge(m, next)) m--;
+				}
+				quad->count = m;
+			}
+		});
+	}
+
+	// moves the edges of the polygon outward by `extend` pixels.
+	// also prepares the buffers for rasterize(), so call this even if `extend` is zero.
+	template<bool handle_corner>
+	void extend_key_points(hull& h, int obj_w, int obj_h, int extend)
+	{
+		auto& LT = h.LT, & LB = h.LB, & RT = h.RT, & RB = h.RB;
+		auto const heap1 = h.heap1, heap2 = h.heap2, heap3 = h.heap3, heap4 = h.heap4;
+
+		// extend the polygon defined by those key points.
+		if (extend > 0) {
+			LT.x_map = heap1; LB.x_map = heap1 + 2 * LT.count;
+			RT.x_map = heap2; RB.x_map = heap2 + 2 * RT.count;
+
+			// suppose the two lines (y-y1)/dy_i=(x-x1)/dx_i (i=1,2) that pass the point (x1, y1).
+			// move them by `length` pixels to the direction orthogonal to themselves.
+			// this lambda calculates the crossing point of the moved lines with some boundary handlings.
+			constexpr auto extend_point = [](int length, int x1, int y1, int dx1, int dy1, int dx2, int dy2,
+				int bound, bool is_head) {
+				auto const
+					l1 = std::sqrtf(static_cast<float>(dx1 * dx1 + dy1 * dy1)),
+					l2 = std::sqrtf(static_cast<float>(dx2 * dx2 + dy2 * dy2));
+				int X1, Y1;
+				if (handle_corner && (dy1 < 0 || dy2 < 0 || dx1 * dx2 < 0)) {
+					// in cases where the signatures of dy1/dx1 and dy2/dx2 do not match.
+					auto const t = dx1 * dy2 - dx2 * dy1;
+					auto ofs_x = -(dx1 * l2 - dx2 * l1) * length / t,
+						ofs_y = -(dy1 * l2 - dy2 * l1) * length / t;
+
+					if (dy1 < 0 || dy2 < 0) {
+						Y1 = y1 + static_cast<int>(std::round(ofs_y));
+						if (is_head ? Y1 < bound : Y1 > bound) {
+							// y-coordinate exceeds the bound.
+							Y1 = bound;
+
+							// move the point along the line to fit within the boundary.
+							// is_head chooses which line to go along with.
+							ofs_y -= bound - y1;
+							ofs_x -= is_head ? ofs_y * dx2 / dy2 : ofs_y * dx1 / dy1;
+						}
+						X1 = x1 + static_cast<int>(std::round(ofs_x));
+					}
+					else {
+						X1 = x1 + static_cast<int>(std::round(ofs_x));
+						if (X1 < bound) {
+							// x-coordinate exceeds the bound.
+							X1 = bound;
+
+							// move the point along the line to fit within the boundary.
+							// is_head chooses which line to go along with.
+							ofs_x -= bound - x1;
+							ofs_y -= is_head ? ofs_x * dy2 / dx2 : ofs_x * dy1 / dx1;
+						}
+						Y1 = y1 + static_cast<int>(std::round(ofs_y));
+					}
+				}
+				else {
+					// dy1, dy2 >= 0 and dx1 * dx2 >= 0.
+					auto const s = (dx1 * dy2 + dx2 * dy1) * length;
+					auto ofs_x = -s / (dx2 * l1 + dx1 * l2), ofs_y = s / (dy2 * l1 + dy1 * l2);
+
+					// they won't go beyond the boundary.
+					X1 = x1 + static_cast<int>(std::round(ofs_x));
+					Y1 = y1 + static_cast<int>(std::round(ofs_y));
+				}
+
+				return std::pair{ X1, Y1 };
+			};
+			multi_thread(work_phase::extend, LT.count + LB.count + RT.count + RB.count, [&](int thread_id, int thread_num) {
+				for (int i = thread_id; i < 4; i += thread_num) {
+					auto const [quad, ext1, ext2, bd1, bd2] = [&] {
+						switch (i) {
+						case 0: return std::tuple{ &LT, &RT, &LB, -extend, -extend };
+						case 1: return std::tuple{ &LB, &LT, &RB, -extend, obj_h + extend - 1 };
+						case 2: return std::tuple{ &RT, &LT, &RB, -extend, ~(obj_w + extend - 1) };
+						case 3: return std::tuple{ &RB, &RT, &LB, ~(obj_w + extend - 1), obj_h + extend - 1 };
+						default: std::unreachable();
+						}
+					}();
+
+					if (quad->count > 1) {
+						int const* pts = quad->key_pts;
+						int x1 = pts[0], y1 = pts[1]; pts += 2;
+
+						int dx1, dy1;
+						if (i % 2 == 0) {
+							if (handle_corner && ext1->count > 1 && x1 == ~ext1->key_pts[0]) {
+								dx1 = x1 - (~ext1->key_pts[2]);
+								dy1 = y1 - ext1->key_pts[3];
+							}
+							else { dx1 = -1; dy1 = 0; }
+						}
+						else {
+							if (handle_corner && ext1->count > 1 && y1 == ext1->btm) {
+								dx1 = x1 - ext1->key_pts[2 * ext1->count - 4];
+								dy1 = y1 - ext1->key_pts[2 * ext1->count - 3];
+							}
+							else { dx1 = 0; dy1 = 1; }
+						}
+						int* dst = quad->x_map;
+						for (int j = quad->count - 1; --j >= 0; pts += 2, dst += 2) {
+							int const x2 = pts[0], y2 = pts[1],
+								dx2 = x2 - x1, dy2 = y2 - y1;
+
+							std::tie(dst[0], dst[1]) = extend_point(extend, x1, y1, dx1, dy1, dx2, dy2, bd1, true);
+
+							x1 = x2; dx1 = dx2;
+							y1 = y2; dy1 = dy2;
+						}
+						{
+							int dx2, dy2;
+							if (i % 2 == 0) {
+								if (handle_corner && ext2->count > 1 && y1 == ext2->top) {
+									dx2 = ext2->key_pts[2] - x1;
+									dy2 = ext2->key_pts[3] - y1;
+								}
+								else { dx2 = 0; dy2 = 1; }
+							}
+							else {
+								if (handle_corner && ext2->count > 1 && x1 == ~ext2->key_pts[2 * ext2->count - 2]) {
+									dx2 = (~ext2->key_pts[2 * ext2->count - 4]) - x1;
+									dy2 = ext2->key_pts[2 * ext2->count - 3] - y1;
+								}
+								else { dx2 = 1; dy2 = 0; }
+							}
+
+							std::tie(dst[0], dst[1]) = extend_point(extend, x1, y1, dx1, dy1, dx2, dy2, bd2, false);
+						}
+					}
+					else {
+						quad->x_map[0] = quad->key_pts[0] - extend;
+						quad->x_map[1] = quad->key_pts[1] + (i % 2 == 0 ? -extend : extend);
+					}
+				}
+			});
+
+			for (auto quad : { &LT, &LB, &RT, &RB }) {
+				quad->key_pts = quad->x_map;
+				quad->top = quad->key_pts[1];
+				quad->btm = quad->key_pts[2 * quad->count - 1];
+			}
+			LT.x_map = LB.x_map = heap3;
+			RT.x_map = RB.x_map = heap4;
+		}
+		else {
+			// vertices dont' change. allocate the buffer for the next calculation.
+			LT.x_map = LB.x_map = heap1;
+			RT.x_map = RB.x_map = heap2;
+		}
+	}
+
+	// represents the area: d*y <= n*(x-1)+s, contained in the box 0 <= x,y <= 1.
+	// helps drawing antialiased lines.
+	struct pixel_walker {
+		// assumes all of these three are positive.
+		uint32_t slope_n, slope_d, state;
+		bool is_next_up() const { return state > slope_d; }
+		uint32_t move_to_top() {
+			auto q = (state - 1) / slope_d,
+				r = (state - 1) % slope_d;
+			state = r + 1;
+			return q;
+		}
+		bool adjust_fullness() {
+			if (state >= slope_n + slope_d) {
+				move_up();
+				return true;
+			}
+			return false;
+		}
+		void move_up() { state -= slope_d; }
+		void move_right() { state += slope_n; }
+		i16 fill_rate() const {
+			if (state >= slope_d) {
+				if (state >= slope_n) {
+					// 1 - 1/2 x (1-(s-n)/d) x (1-(s-d)/n) = 1 - (n+d-s)^2/(2*n*d).
+					auto const a = slope_n + slope_d - state;
+					return static_cast<i16>(max_alpha - (max_alpha * a * a) / (2 * slope_n * slope_d));
+				}
+				else {
+					// 1 - 1/2 x ((1-s/n)+(1-(s-d)/n)) = (s-d/2)/n.
+					return static_cast<i16>((max_alpha * (2 * state - slope_d)) / (2 * slope_n));
+				}
+			}
+			else {
+				if (state >= slope_n) {
+					// 1/2 x (s/d + (s-n)/d) = (s-n/2)/d.
+					return static_cast<i16>((max_alpha * (2 * state - slope_n)) / (2 * slope_d));
+				}
+				else {
+					// 1/2 x s/d x s/n.
+					return static_cast<i16>((max_alpha * (state * state)) / (2 * slope_n * slope_d));
+				}
+			}
+		}
+
+		pixel_walker(uint32_t n, uint32_t d) : slope_n{ n }, slope_d{ d }, state{ n } {}
+		pixel_walker(int n, int d) : pixel_walker(static_cast<uint32_t>(n), static_cast<uint32_t>(d)) {}
+	};
+
+	// draws the edges of the polygon into the alpha channel of the destination, `extend` pixels shifted,
+	// and rewrites the x_map so that rasterize_line() can fill the rest.
+	template<size_t dst_step, bool antialias, write_mode mode = write_mode::overwrite>
+	void rasterize_edges(hull const& h, i16* dst_buf, size_t dst_stride, int extend)
+	{
+		auto LT = h.LT, LB = h.LB, RT = h.RT, RB = h.RB;
+		constexpr auto write = [](i16& dst, int val) {
+			if constexpr (mode == write_mode::subtract) dst = static_cast<i16>(std::max(dst - val, 0));
+			else if constexpr (mode == write_mode::combine) dst = static_cast<i16>(std::max<int>(dst, val));
+			else dst = static_cast<i16>(val);
+		};
+
+		// draw line segments surrounding those key points,
+		// and at the same time, rewrite left_map and right_map so
+		// they identify the range of the pixels to be filled opaque.
+		multi_thread(work_phase::edges, 2 * (LB.btm + 1 - LT.top), [&](int thread_id, int thread_num) {
+			// parallel loop up to six threads.
+			for (int i = thread_id; i < 6; i += thread_num) {
+				switch (i) {
+				case 0:
+				{
+					// initial key point.
+					auto const* pts = LT.key_pts;
+					int x0 = pts[0] + extend, y0 = pts[1] + extend; pts += 2;
+					auto* x_map = LT.x_map + 2 * y0;
+					for (int j = LT.count - 1; --j >= 0; pts += 2) {
+						// find the next key point, and setup a state machine.
+						int const x1 = pts[0] + extend, y1 = pts[1] + extend;
+						pixel_walker pw{ x0 - x1, y1 - y0 };
+
+						// walk through pixels while drawing lines.
+						x0--;
+						if constexpr (antialias) {
+							for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
+								y0 < y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
+								x_map[1] = x0 + 1; // beginning of "black" pixels.
+								while (true) { // move horizontally.
+									write(*dst, pw.fill_rate());
+									if (!pw.is_next_up()) break;
+									pw.move_up(); x0--; dst -= dst_step;
+								}
+								x_map[0] = x0; // end of "white" pixels + 1.
+							}
+						}
+						else {
+							for (; y0 < y1; pw.move_right(), y0++, x_map += 2) {
+								if (pw.adjust_fullness()) x0--; // adjust corner case.
+
+								// end of "white" pixels + 1 / beginning of "black" pixels.
+								x_map[0] = x_map[1] = x0 + 1;
+
+								x0 -= pw.move_to_top(); // move horizontally.
+							}
+						}
+
+						// update the last key point.
+						y0 = y1; x0 = x1;
+					}
+					break;
+				}
+				case 1:
+				{
+					// initial key point
+					auto const* pts = LB.key_pts;
+					int x0 = pts[0] + extend, y0 = pts[1] + extend; pts += 2;
+					auto* x_map = LB.x_map + 2 * (y0 + 1);
+					for (int j = LB.count - 1; --j >= 0; pts += 2) {
+						// find the next key point, and setup a state machine.
+						int const x1 = pts[0] + extend, y1 = pts[1] + extend;
+						pixel_walker pw{ x1 - x0, y1 - y0 };
+
+						// walk through pixels while drawing lines.
+						y0++;
+						if constexpr (antialias) {
+							for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
+								y0 <= y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
+								x_map[0] = x0; // end of "white" pixels + 1.
+								while (true) { // move horizontally.
+									write(*dst, max_alpha - pw.fill_rate());
+									if (!pw.is_next_up()) break;
+									pw.move_up(); x0++; dst += dst_step;
+								}
+								x_map[1] = x0 + 1; // beginning of "black" pixels.
+							}
+						}
+						else {
+							for (; y0 <= y1; pw.move_right(), y0++, x_map += 2) {
+								x0 += pw.move_to_top(); // move horizontally.
+
+								// end of "white" pixels + 1 / beginning of "black" pixels.
+								x_map[0] = x_map[1] = x0 + 1;
+							}
+						}
+
+						// update the last key point.
+						y0 = y1; x0 = x1;
+					}
+					break;
+				}
+				case 2:
+				{
+					// initial key point.
+					auto const* pts = RT.key_pts;
+					int x0 = (~pts[0]) + extend, y0 = pts[1] + extend; pts += 2;
+					auto* x_map = RT.x_map + 2 * y0;
+					for (int j = RT.count - 1; --j >= 0; pts += 2) {
+						// find the next key point, and setup a state machine.
+						int const x1 = (~pts[0]) + extend, y1 = pts[1] + extend;
+						pixel_walker pw{ x1 - x0, y1 - y0 };
+
+						// walk through pixels while drawing lines.
+						x0++;
+						if constexpr (antialias) {
+							for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
+								y0 < y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
+								x_map[0] = x0; // end of "black" pixels + 1.
+								while (true) { // move horizontally.
+									write(*dst, pw.fill_rate());
+									if (!pw.is_next_up()) break;
+									pw.move_up(); x0++; dst += dst_step;
+								}
+								x_map[1] = x0 + 1; // beginning of "white" pixels.
+							}
+						}
+						else {
+							for (; y0 < y1; pw.move_right(), y0++, x_map += 2) {
+								if (pw.adjust_fullness()) x0++; // adjust corner case.
+
+								// beginning of "white" pixels / end of "black" pixels + 1.
+								x_map[0] = x_map[1] = x0;
+
+								x0 += pw.move_to_top(); // move horizontally.
+							}
+						}
+
+						// update the last key point.
+						y0 = y1; x0 = x1;
+					}
+					break;
+				}
+				case 3:
+				{
+					// initial key point
+					auto const* pts = RB.key_pts;
+					int x0 = (~pts[0]) + extend, y0 = pts[1] + extend; pts += 2;
+					auto* x_map = RB.x_map + 2 * (y0 + 1);
+					for (int j = RB.count - 1; --j >= 0; pts += 2) {
+						// find the next key point, and setup a state machine.
+						int const x1 = (~pts[0]) + extend, y1 = pts[1] + extend;
+						pixel_walker pw{ x0 - x1, y1 - y0 };
+
+						// walk through pixels while drawing lines.
+						y0++;
+						if constexpr (antialias) {
+							for (i16* dst = dst_buf + x0 * dst_step + y0 * dst_stride;
+								y0 <= y1; pw.move_right(), y0++, dst += dst_stride, x_map += 2) {
+								x_map[1] = x0 + 1; // beginning of "white" pixels.
+								while (true) { // move horizontally.
+									write(*dst, max_alpha - pw.fill_rate());
+									if (!pw.is_next_up()) break;
+									pw.move_up(); x0--; dst -= dst_step;
+								}
+								x_map[0] = x0; // end of "black" pixels + 1.
+							}
+						}
+						else {
+							for (; y0 <= y1; pw.move_right(), y0++, x_map += 2) {
+								x0 -= pw.move_to_top(); // move horizontally.
+
+								// beginning of "white" pixels / end of "black" pixels + 1.
+								x_map[0] = x_map[1] = x0;
+							}
+						}
+
+						// update the last key point.
+						y0 = y1; x0 = x1;
+					}
+					break;
+				}
+				case 4:
+				{
+					// handle pixels between y_l_top and y_l_btm.
+					int const x12 = LB.key_pts[0] + extend;
+					auto* x_map = LT.x_map + 2 * (LT.btm + extend);
+					for (int j = LB.top - LT.btm + 1; --j >= 0; x_map += 2)
+						x_map[0] = x_map[1] = x12;
+					break;
+				}
+				case 5:
+				{
+					// handle pixels between y_r_top and y_r_btm.
+					int const x34 = (~RB.key_pts[0]) + 1 + extend;
+					auto* x_map = RT.x_map + 2 * (RT.btm + extend);
+					for (int j = RB.top - RT.btm + 1; --j >= 0; x_map += 2)
+						x_map[0] = x_map[1] = x34;
+					break;
+				}
+				}
+			}
+		});
+	}
+
+	// sets `n` values, each `dst_step` apart, to `val`.
+	// for `dst_step` of 4, `dst` must be the alpha channel of PixelYCA.
+	template<size_t dst_step>
+	inline void fill_span(i16* dst, int n, i16 val)
+	{
+		if constexpr (dst_step == 4) kernels::active.fill_alpha(dst, n, val);
+		else if constexpr (dst_step == 1) std::fill_n(dst, std::max(n, 0), val);
+		else for (int i = n; --i >= 0; dst += dst_step) *dst = val;
+	}
+
+	// fills the pixels on the line y other than the edges, after rasterize_edges().
+	// unless `mode` is overwrite, pixels outside the polygon are left untouched.
+	template<size_t dst_step, write_mode mode = write_mode::overwrite>
+	void rasterize_line(hull const& h, i16* dst_buf, int dst_w, size_t dst_stride, int extend, int y)
+	{
+		i16* dst_y = dst_buf + y * dst_stride;
+		if (y < h.LT.top + extend || y > h.RB.btm + extend) {
+			if constexpr (mode == write_mode::overwrite)
+				fill_span<dst_step>(dst_y, dst_w, 0);
+		}
+		else if constexpr (mode != write_mode::overwrite) {
+			// only the middle part is affected.
+			int const x2 = h.LT.x_map[2 * y + 1], x3 = h.RB.x_map[2 * y];
+			fill_span<dst_step>(dst_y + x2 * dst_step, x3 - x2,
+				mode == write_mode::subtract ? 0 : max_alpha);
+		}
+		else {
+			auto const l = h.LT.x_map + 2 * y, r = h.RB.x_map + 2 * y;
+			int x1 = l[0], x2 = l[1], x3 = r[0], x4 = r[1];
+
+			// white on the left side.
+			fill_span<dst_step>(dst_y, x1, 0);
+
+			// black on the middle.
+			fill_span<dst_step>(dst_y + x2 * dst_step, x3 - x2, max_alpha);
+
+			// white on the right side.
+			fill_span<dst_step>(dst_y + x4 * dst_step, dst_w - x4, 0);
+		}
+	}
+
+	// draws the polygon into the alpha channel of the destination, `extend` pixels shifted.
+	// unless `mode` is overwrite, pixels outside the polygon are left untouched.
+	template<size_t dst_step, bool antialias, write_mode mode = write_mode::overwrite>
+	void rasterize(hull const& h, i16* dst_buf, int dst_w, int dst_h, size_t dst_stride, int extend)
+	{
+		rasterize_edges<dst_step, antialias, mode>(h, dst_buf, dst_stride, extend);
+
+		// fill the rest of pixels.
+		int top = 0, btm = dst_h - 1;
+		if constexpr (mode != write_mode::overwrite) {
+			// only the lines the polygon spans are affected.
+			top = std::max(h.LT.top + extend, 0);
+			btm = std::min(h.RB.btm + extend, dst_h - 1);
+		}
+		multi_thread(work_phase::fill, (btm - top + 1) * dst_w, [&](int thread_id, int thread_num) {
+			for (int y = top + thread_id; y <= btm; y += thread_num)
+				rasterize_line<dst_step, mode>(h, dst_buf, dst_w, dst_stride, extend, y);
+		});
+	}
+
+	// lists the vertices of the polygon, down the left side and then up the right side,
+	// where pixels are unit squares and the top-left corner of the object is the origin.
+	// `pts` must have room for as many points as the sum of `count` of the four quadrants.
+	// returns the number of the vertices.
+	inline int polygon(hull const& h, int* pts)
+	{
+		int n = 0;
+		auto const push = [&](int x, int y) {
+			if (n > 0 && pts[2 * n - 2] == x && pts[2 * n - 1] == y) return;
+			pts[2 * n] = x; pts[2 * n + 1] = y;
+			n++;
+		};
+
+		// key points on the left side stand for the top-left or bottom-left corners of the pixels.
+		for (int i = 0; i < h.LT.count; i++) push(h.LT.key_pts[2 * i], h.LT.key_pts[2 * i + 1]);
+		for (int i = 0; i < h.LB.count; i++) push(h.LB.key_pts[2 * i], h.LB.key_pts[2 * i + 1] + 1);
+
+		// those on the right side have their x-coordinates flipped.
+		for (int i = h.RB.count; --i >= 0;) push((~h.RB.key_pts[2 * i]) + 1, h.RB.key_pts[2 * i + 1] + 1);
+		for (int i = h.RT.count; --i >= 0;) push((~h.RT.key_pts[2 * i]) + 1, h.RT.key_pts[2 * i + 1]);
+
+		if (n > 1 && pts[0] == pts[2 * n - 2] && pts[1] == pts[2 * n - 1]) n--;
+		return n;
+	}
+
+	// the bounding box of the polygon, in the same coordinates as polygon().
+	struct box { int left, top, right, bottom; };
+	inline box bounding_box(hull const& h)
+	{
+		box b{ h.LT.key_pts[0], h.LT.key_pts[1], (~h.RT.key_pts[0]) + 1, h.RT.key_pts[1] };
+		for (auto quad : { &h.LT, &h.LB }) {
+			for (int i = 0; i < quad->count; i++) {
+				b.left = std::min(b.left, quad->key_pts[2 * i]);
+				b.top = std::min(b.top, quad->key_pts[2 * i + 1]);
+				b.bottom = std::max(b.bottom, quad->key_pts[2 * i + 1] + 1);
+			}
+		}
+		for (auto quad : { &h.RT, &h.RB }) {
+			for (int i = 0; i < quad->count; i++) {
+				b.right = std::max(b.right, (~quad->key_pts[2 * i]) + 1);
+				b.top = std::min(b.top, quad->key_pts[2 * i + 1]);
+				b.bottom = std::max(b.bottom, quad->key_pts[2 * i + 1] + 1);
+			}
+		}
+		return b;
+	}
+
+	template<size_t src_step, size_t dst_step, bool antialias, bool handle_corner, class src_t>
+	bool calc_convex_closure(src_t const* src_buf, int obj_w, int obj_h, size_t src_stride,
+		std::type_identity_t<src_t> threshold, i16* dst_buf, size_t dst_stride, int extend, bool draft, void* heap)
+	{
+		int const dst_w = obj_w + 2 * extend, dst_h = obj_h + 2 * extend;
+		hull h{ heap, dst_h };
+		if (!find_key_points<src_step>(h, src_buf, obj_w, obj_h, src_stride, threshold, draft)) return false;
+		extend_key_points<handle_corner>(h, obj_w, obj_h, extend);
+		rasterize<dst_step, antialias>(h, dst_buf, dst_w, dst_h, dst_stride, extend);
+		return true;
+	}
+}
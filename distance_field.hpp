@@ -0,0 +1,359 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "multi_thread.hpp"
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 凸包からの距離による描画．
+////////////////////////////////
+namespace convex_closure
+{
+	// the polygon split into the left and right chains, each from top to bottom.
+	// vertices are at the corners of pixels, as in polygon().
+	struct outline {
+		int* left, * right; // pairs of x and y.
+		int n_left, n_right;
+
+		// the leftmost/rightmost x-coordinates, and the ranges of y where they're attained.
+		int l_min, l_min_top, l_min_btm;
+		int r_max, r_max_top, r_max_btm;
+
+		// `buf` must have room as large as the x_map of the hull, which is no longer used after extension.
+		// the slight dents left by rounding the extended vertices are filled,
+		// so the chains are strictly convex, which the distances below rely on.
+		outline(hull const& h, int* buf) : left{ buf }, n_left{ 0 }
+		{
+			// `s` is 1 for the left chain, or -1 for the right.
+			auto const push = [](int* chain, int& n, int x, int y, int s) {
+				if (n > 0 && chain[2 * n - 2] == x && chain[2 * n - 1] == y) return;
+				while (n >= 2) {
+					int const xa = chain[2 * n - 4], ya = chain[2 * n - 3],
+						xb = chain[2 * n - 2], yb = chain[2 * n - 1];
+					// keep the last point only if it's strictly outside.
+					if (s * ((xb - xa) * (y - ya) - (x - xa) * (yb - ya)) < 0) break;
+					n--;
+				}
+				chain[2 * n] = x; chain[2 * n + 1] = y;
+				n++;
+			};
+			for (int i = 0; i < h.LT.count; i++) push(left, n_left, h.LT.key_pts[2 * i], h.LT.key_pts[2 * i + 1], 1);
+			for (int i = 0; i < h.LB.count; i++) push(left, n_left, h.LB.key_pts[2 * i], h.LB.key_pts[2 * i + 1] + 1, 1);
+
+			right = left + 2 * n_left; n_right = 0;
+			for (int i = 0; i < h.RT.count; i++) push(right, n_right, (~h.RT.key_pts[2 * i]) + 1, h.RT.key_pts[2 * i + 1], -1);
+			for (int i = 0; i < h.RB.count; i++) push(right, n_right, (~h.RB.key_pts[2 * i]) + 1, h.RB.key_pts[2 * i + 1] + 1, -1);
+
+			l_min = left[0]; l_min_top = l_min_btm = left[1];
+			for (int i = 1; i < n_left; i++) {
+				if (left[2 * i] < l_min) { l_min = left[2 * i]; l_min_top = left[2 * i + 1]; }
+				if (left[2 * i] == l_min) l_min_btm = left[2 * i + 1];
+			}
+			r_max = right[0]; r_max_top = r_max_btm = right[1];
+			for (int i = 1; i < n_right; i++) {
+				if (right[2 * i] > r_max) { r_max = right[2 * i]; r_max_top = right[2 * i + 1]; }
+				if (right[2 * i] == r_max) r_max_btm = right[2 * i + 1];
+			}
+		}
+
+		int top() const { return std::min(left[1], right[1]); }
+		int btm() const { return std::max(left[2 * n_left - 1], right[2 * n_right - 1]); }
+
+		// x-coordinate of the chain at y.
+		static float x_at(int const* chain, int n, float y)
+		{
+			// find the last vertex at or above y.
+			int i = index_at(chain, n, y);
+			if (i >= n - 1) return static_cast<float>(chain[2 * (n - 1)]);
+			int const x0 = chain[2 * i], y0 = chain[2 * i + 1],
+				dx = chain[2 * i + 2] - x0, dy = chain[2 * i + 3] - y0;
+			if (dy <= 0 || y <= y0) return static_cast<float>(x0);
+			return x0 + dx * (y - y0) / dy;
+		}
+		float x_left(float y) const { return x_at(left, n_left, y); }
+		float x_right(float y) const { return x_at(right, n_right, y); }
+
+		// the polygon as a cycle of vertices, down the left chain and up the right one,
+		// where the i-th edge runs from the i-th vertex to the next, with its outward side on the left when seen from above.
+		// the edges between the chains may be of zero length.
+		int n_cycle() const { return n_left + n_right; }
+		std::pair<int, int> vertex(int i) const
+		{
+			if (i >= n_left + n_right) i -= n_left + n_right;
+			int const* p = i < n_left ? left + 2 * i : right + 2 * (n_left + n_right - 1 - i);
+			return { p[0], p[1] };
+		}
+		// index in the cycle of the edge between the i-th and (i+1)-th vertices of the right chain.
+		int right_edge(int i) const { return n_left + n_right - 2 - i; }
+
+		// index of the last vertex whose y-coordinate is at most y, or 0 if none.
+		static int index_at(int const* chain, int n, float y)
+		{
+			int lo = 0, hi = n;
+			while (hi - lo > 1) {
+				int const mid = (lo + hi) >> 1;
+				if (chain[2 * mid + 1] <= y) lo = mid; else hi = mid;
+			}
+			return lo;
+		}
+
+		// the range of x on the line y of the points within the distance r from the polygon,
+		// which is empty (lo > hi) if the line misses it.
+		// the boundary consists of the edges moved outward by r and the arcs around the vertices,
+		// so the extremes are found among those near the line.
+		std::pair<float, float> dilated_span(float y, float r) const
+		{
+			float lo = std::numeric_limits<float>::infinity(), hi = -lo;
+			auto const vertex = [&](int x0, int y0) {
+				float const dy = y - y0;
+				if (dy * dy > r * r) return;
+				float const dx = std::sqrt(r * r - dy * dy);
+				lo = std::min(lo, x0 - dx); hi = std::max(hi, x0 + dx);
+			};
+			// the edge from (x0, y0) to (x1, y1), whose outward side is on the left when seen from above.
+			auto const edge = [&](int x0, int y0, int x1, int y1) {
+				float const dx = static_cast<float>(x1 - x0), dy = static_cast<float>(y1 - y0),
+					len = std::sqrt(dx * dx + dy * dy);
+				if (dy == 0 || len <= 0) return;
+				float const sx = x0 - r * dy / len, sy = y0 + r * dx / len,
+					t = (y - sy) / dy;
+				if (t < 0 || t > 1) return;
+				float const x = sx + t * dx;
+				lo = std::min(lo, x); hi = std::max(hi, x);
+			};
+			auto const chain = [&](int const* c, int n, bool rev) {
+				int const i0 = index_at(c, n, y - r), i1 = std::min(index_at(c, n, y + r) + 1, n - 1);
+				for (int i = i0; i <= i1; i++) vertex(c[2 * i], c[2 * i + 1]);
+				for (int i = i0; i < i1; i++) {
+					if (rev) edge(c[2 * i + 2], c[2 * i + 3], c[2 * i], c[2 * i + 1]);
+					else edge(c[2 * i], c[2 * i + 1], c[2 * i + 2], c[2 * i + 3]);
+				}
+			};
+			chain(left, n_left, false);
+			chain(right, n_right, true);
+			// the top and bottom edges between the chains.
+			edge(right[0], right[1], left[0], left[1]);
+			edge(left[2 * n_left - 2], left[2 * n_left - 1], right[2 * n_right - 2], right[2 * n_right - 1]);
+			return { lo, hi };
+		}
+	};
+
+	// makes a function that evaluates the signed distance d from the outline at the center of each pixel
+	// on the given line, which is negative inside, and writes fn(d) into the alpha channel.
+	// pixels at d <= d_in are filled by fn(d_in), and at d >= d_out by fn(d_out),
+	// so fn() is called only on the pixels within the band between them.
+	// unless `mode` is overwrite, pixels at d >= d_out are left untouched, assuming fn(d_out) is zero.
+	// the buffer of the outline must outlive the returned function.
+	template<size_t dst_step, write_mode mode = write_mode::overwrite>
+	auto field_rasterizer(outline const& ol, i16* dst_buf, int dst_w, size_t dst_stride, int extend,
+		float d_in, float d_out, auto fn)
+	{
+		constexpr auto write = [](i16& dst, i16 val) {
+			if constexpr (mode == write_mode::subtract) dst = static_cast<i16>(std::max(dst - val, 0));
+			else if constexpr (mode == write_mode::combine) dst = std::max(dst, val);
+			else dst = val;
+		};
+		i16 const v_in = fn(d_in), v_out = fn(d_out);
+		float const top = static_cast<float>(ol.top()), btm = static_cast<float>(ol.btm()),
+			r_in = std::max(-d_in, 0.0f), r_out = std::max(d_out, 0.0f),
+			reach = std::max(std::abs(d_in), std::abs(d_out)) + 2;
+		int const m = ol.n_cycle();
+
+		// ranges of the chains over the lines between y0 and y1.
+		// as the left chain is convex and the right one concave, extremes are at either end,
+		// or at the leftmost/rightmost vertices.
+		struct range { float l_lo, l_hi, r_lo, r_hi; };
+		auto const range_of = [=](float y0, float y1) {
+			float const l0 = ol.x_left(y0), l1 = ol.x_left(y1), r0 = ol.x_right(y0), r1 = ol.x_right(y1);
+			return range{
+				y1 >= ol.l_min_top && y0 <= ol.l_min_btm ? ol.l_min : std::min(l0, l1), std::max(l0, l1),
+				std::min(r0, r1), y1 >= ol.r_max_top && y0 <= ol.r_max_btm ? ol.r_max : std::max(r0, r1),
+			};
+		};
+
+		// position of the projection of (px, py) on the line of the i-th edge, from 0 to 1 on the edge,
+		// and the squared distance to the edge.
+		auto const project = [ol](int i, float px, float py) {
+			auto const [x0, y0] = ol.vertex(i);
+			auto const [x1, y1] = ol.vertex(i + 1);
+			float const dx = static_cast<float>(x1 - x0), dy = static_cast<float>(y1 - y0),
+				ex = px - x0, ey = py - y0, l2 = dx * dx + dy * dy;
+			float const t = l2 > 0 ? (ex * dx + ey * dy) / l2 : 0.0f, c = std::clamp(t, 0.0f, 1.0f);
+			return std::pair{ t, (ex - c * dx) * (ex - c * dx) + (ey - c * dy) * (ey - c * dy) };
+		};
+		auto const degenerate = [ol](int i) { return ol.vertex(i) == ol.vertex(i + 1); };
+		auto const next = [=](int i) { do i = i + 1 < m ? i + 1 : 0; while (degenerate(i)); return i; };
+		auto const prev = [=](int i) { do i = i > 0 ? i - 1 : m - 1; while (degenerate(i)); return i; };
+
+		// the nearest point outside the polygon moves monotonically along the outline as the pixel moves along the line,
+		// so the nearest edge is followed from that of the previous pixel, taking a constant time per pixel on average.
+		auto const follow = [=](int i, float px, float py) {
+			for (int k = 0; k < m; k++) {
+				float const t = project(i, px, py).first;
+				int const j = t < 0 ? prev(i) : t > 1 ? next(i) : i;
+				if (j == i) break;
+				// stop at the vertex between them.
+				float const u = project(j, px, py).first;
+				if (t < 0 ? u >= 1 : u <= 0) break;
+				i = j;
+			}
+			return i;
+		};
+
+		return [=](int y) {
+			i16* dst = dst_buf + y * dst_stride;
+			float const cy = y + 0.5f - extend, ofs_x = extend - 0.5f;
+
+			// pixels in [ox0, ox1) may be closer than d_out, and [ix0, ix1) are surely within d_in.
+			// the spans outside the polygon are exact, with a pixel to spare for rounding errors.
+			int ox0 = 0, ox1 = 0, ix0 = 0, ix1 = 0;
+			if (cy >= top - r_out && cy <= btm + r_out) {
+				auto const [lo, hi] = ol.dilated_span(cy, r_out);
+				if (lo <= hi) {
+					ox0 = std::clamp(static_cast<int>(std::floor(lo + ofs_x)) - 1, 0, dst_w);
+					ox1 = std::clamp(static_cast<int>(std::ceil(hi + ofs_x)) + 2, ox0, dst_w);
+				}
+			}
+			ix0 = ix1 = ox0;
+			if (d_in > 0) {
+				auto const [lo, hi] = ol.dilated_span(cy, d_in);
+				if (lo <= hi) {
+					ix0 = std::clamp(static_cast<int>(std::ceil(lo + ofs_x)) + 1, ox0, ox1);
+					ix1 = std::clamp(static_cast<int>(std::floor(hi + ofs_x)), ix0, ox1);
+				}
+			}
+			else if (cy >= top + r_in && cy <= btm - r_in) {
+				auto const rg = range_of(cy - r_in, cy + r_in);
+				ix0 = std::clamp(static_cast<int>(std::ceil(rg.l_hi + r_in + ofs_x)), ox0, ox1);
+				ix1 = std::clamp(static_cast<int>(std::floor(rg.r_lo - r_in + ofs_x)) + 1, ix0, ox1);
+			}
+
+			// edges that can be within the reach from this line.
+			float const y_lo = cy - reach, y_hi = cy + reach;
+			int const
+				l0 = outline::index_at(ol.left, ol.n_left, y_lo), l1 = std::min(outline::index_at(ol.left, ol.n_left, y_hi), ol.n_left - 2),
+				r0 = outline::index_at(ol.right, ol.n_right, y_lo), r1 = std::min(outline::index_at(ol.right, ol.n_right, y_hi), ol.n_right - 2);
+			bool const near_top = y_lo <= top, near_btm = y_hi >= btm,
+				in_rows = cy >= top && cy <= btm;
+			auto const for_near = [&](auto&& f) {
+				for (int i = l0; i <= l1; i++) f(i);
+				for (int i = r0; i <= r1; i++) f(ol.right_edge(i));
+				if (near_btm && !degenerate(ol.n_left - 1)) f(ol.n_left - 1);
+				if (near_top && !degenerate(m - 1)) f(m - 1);
+			};
+			float const xl = ol.x_left(cy), xr = ol.x_right(cy);
+
+			// inside, the distance is the least of those from the lines of the edges, which are linear along this line.
+			// their lower envelope is made when the first pixel inside comes, as pairs of slope and intercept.
+			static thread_local std::vector<std::pair<float, float>> env{};
+			size_t env_i = 0; bool env_made = false;
+			auto const inside = [&](float px) {
+				if (!env_made) {
+					env_made = true; env.clear();
+					for_near([&](int i) {
+						auto const [x0, y0] = ol.vertex(i);
+						auto const [x1, y1] = ol.vertex(i + 1);
+						float const dx = static_cast<float>(x1 - x0), dy = static_cast<float>(y1 - y0),
+							len = std::sqrt(dx * dx + dy * dy);
+						env.emplace_back(dy / len, -(x0 * dy + (cy - y0) * dx) / len);
+					});
+					// by descending slopes, as they take turns from the left.
+					std::ranges::sort(env, [](auto const& a, auto const& b) {
+						return a.first != b.first ? a.first > b.first : a.second < b.second; });
+					size_t n = 0;
+					for (size_t k = 0; k < env.size(); k++) {
+						auto const [a3, b3] = env[k];
+						if (n > 0 && env[n - 1].first == a3) continue;
+						while (n >= 2) {
+							auto const [a1, b1] = env[n - 2]; auto const [a2, b2] = env[n - 1];
+							if ((b3 - b1) * (a1 - a2) > (b2 - b1) * (a1 - a3)) break;
+							n--;
+						}
+						env[n++] = env[k];
+					}
+					env.resize(n);
+				}
+				if (env.empty()) return -std::numeric_limits<float>::infinity();
+				auto const at = [&](size_t k) { return env[k].first * px + env[k].second; };
+				while (env_i + 1 < env.size() && at(env_i + 1) <= at(env_i)) env_i++;
+				return -std::max(at(env_i), 0.0f);
+			};
+
+			// outside, the nearest edge is searched among those within the reach at the first pixel of each run,
+			// and followed from there.
+			int edge = -1, last_x = -2;
+			auto const outside = [&](float px, int x) {
+				if (edge < 0 || x != last_x + 1) {
+					float best = std::numeric_limits<float>::infinity();
+					edge = -1;
+					for_near([&](int i) {
+						float const d2 = project(i, px, cy).second;
+						if (d2 < best) { best = d2; edge = i; }
+					});
+					if (edge < 0) return std::numeric_limits<float>::infinity();
+				}
+				else edge = follow(edge, px, cy);
+				last_x = x;
+				return std::sqrt(project(edge, px, cy).second);
+			};
+
+			auto const value = [&](int x) -> i16 {
+				float const px = x + 0.5f - extend;
+				float d;
+				if (in_rows && xl <= px && px <= xr) { d = inside(px); edge = -1; }
+				else d = outside(px, x);
+				return d <= d_in ? v_in : d >= d_out ? v_out : fn(d);
+			};
+
+			int x = 0;
+			if constexpr (mode == write_mode::overwrite)
+				for (; x < ox0; x++, dst += dst_step) *dst = v_out;
+			else { x = ox0; dst += ox0 * dst_step; }
+			for (; x < ix0; x++, dst += dst_step) write(*dst, value(x));
+			for (; x < ix1; x++, dst += dst_step) write(*dst, v_in);
+			for (; x < ox1; x++, dst += dst_step) write(*dst, value(x));
+			if constexpr (mode == write_mode::overwrite)
+				for (; x < dst_w; x++, dst += dst_step) *dst = v_out;
+		};
+	}
+
+	// draws the whole destination by field_rasterizer().
+	template<size_t dst_step, write_mode mode = write_mode::overwrite>
+	void rasterize_field(outline const& ol, i16* dst_buf, int dst_w, int dst_h, size_t dst_stride, int extend,
+		float d_in, float d_out, auto&& fn)
+	{
+		auto const line = field_rasterizer<dst_step, mode>(ol, dst_buf, dst_w, dst_stride, extend, d_in, d_out, fn);
+
+		// lines to process.
+		int y0 = 0, y1 = dst_h;
+		if constexpr (mode != write_mode::overwrite) {
+			float const r_out = std::max(d_out, 0.0f);
+			y0 = std::max(static_cast<int>(std::ceil(ol.top() - r_out + extend - 0.5f)), 0);
+			y1 = std::min(static_cast<int>(std::floor(ol.btm() + r_out + extend - 0.5f)) + 1, dst_h);
+			if (y0 >= y1) return;
+		}
+
+		multi_thread(work_phase::field, (y1 - y0) * dst_w, [&](int thread_id, int thread_num) {
+			for (int y = y0 + thread_id; y < y1; y += thread_num) line(y);
+		});
+	}
+}
@@ -0,0 +1,289 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "kernels.hpp"
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 外接図形の計算．
+////////////////////////////////
+namespace convex_closure
+{
+	// the shapes drawn in place of the convex closure, each enclosing it with the least area.
+	enum class enclosing_kind : int { hull, rectangle, circle, ellipse };
+
+	// a rectangle or an ellipse centered at (cx, cy), with its axes along (ux, uy) and (-uy, ux)
+	// and the half lengths rx and ry along them. a circle is an ellipse with rx == ry.
+	// derived from the vertices of the convex closure, so it takes time only as many as those.
+	struct enclosing {
+		enclosing_kind kind = enclosing_kind::hull;
+		double cx = 0, cy = 0, ux = 1, uy = 0, rx = 0, ry = 0;
+
+		// fits the shape of `kind` to the convex closure of the key points in `h`, before extension,
+		// moved by `offset` pixels to the right and down, and then outward by `extend`.
+		void fit(hull const& h, enclosing_kind kind, int offset, float extend)
+		{
+			this->kind = kind;
+			pts.resize(2 * (h.LT.count + h.LB.count + h.RT.count + h.RB.count));
+			int const n_pts = polygon(h, pts.data());
+
+			// drop the vertices on the straight lines, so the polygon is strictly convex.
+			v.clear();
+			for (int i = 0; i < n_pts; i++) {
+				int const* const p = &pts[2 * ((i + n_pts - 1) % n_pts)], * const q = &pts[2 * i], * const r = &pts[2 * ((i + 1) % n_pts)];
+				if (int64_t{ q[0] - p[0] } *(r[1] - q[1]) != int64_t{ q[1] - p[1] } *(r[0] - q[0]))
+					v.push_back({ static_cast<double>(q[0] + offset), static_cast<double>(q[1] + offset) });
+			}
+
+			// a pixel is a square already, so there are always three vertices or more.
+			switch (kind) {
+			case enclosing_kind::rectangle: fit_rectangle(); break;
+			case enclosing_kind::circle: fit_circle(); break;
+			default: fit_ellipse(); break;
+			}
+			rx += extend; ry += extend;
+		}
+
+		// the bounding box of the shape moved outward by `ext`, in pixels.
+		box bounds(float ext) const
+		{
+			double const a = rx + ext, b = ry + ext,
+				hw = kind == enclosing_kind::rectangle ? std::abs(a * ux) + std::abs(b * uy) : std::hypot(a * ux, b * uy),
+				hh = kind == enclosing_kind::rectangle ? std::abs(a * uy) + std::abs(b * ux) : std::hypot(a * uy, b * ux);
+			return {
+				static_cast<int>(std::floor(cx - hw)), static_cast<int>(std::floor(cy - hh)),
+				static_cast<int>(std::ceil(cx + hw)), static_cast<int>(std::ceil(cy + hh)),
+			};
+		}
+
+	private:
+		struct point { double x, y; };
+		std::vector<int> pts;
+		std::vector<point> v;
+		std::vector<double> weight, dist;
+
+		// rotating calipers (https://en.wikipedia.org/wiki/Rotating_calipers):
+		// the least rectangle has a side on an edge of the polygon, and as the edge goes around,
+		// the farthest vertices ahead, aside and behind it go around in the same direction.
+		void fit_rectangle()
+		{
+			int const n = static_cast<int>(v.size());
+			auto const at = [&](int i) -> point const& { return v[i % n]; };
+
+			// the inside is on the left of each edge if the signed area is positive.
+			double area = 0;
+			for (int i = 0; i < n; i++) area += at(i).x * at(i + 1).y - at(i + 1).x * at(i).y;
+			double const side = area > 0 ? 1 : -1;
+
+			double best = std::numeric_limits<double>::infinity();
+			for (int i = 0, a = 1, b = 1, c = 1; i < n; i++) {
+				auto const& o = at(i);
+				double const ex = at(i + 1).x - o.x, ey = at(i + 1).y - o.y, len = std::hypot(ex, ey),
+					dx = ex / len, dy = ey / len, nx = -side * dy, ny = side * dx;
+				auto const along = [&](int j) { return (at(j).x - o.x) * dx + (at(j).y - o.y) * dy; };
+				auto const aside = [&](int j) { return (at(j).x - o.x) * nx + (at(j).y - o.y) * ny; };
+
+				a = std::max(a, i + 1);
+				while (along(a + 1) > along(a)) a++;
+				b = std::max(b, a);
+				while (aside(b + 1) > aside(b)) b++;
+				c = std::max(c, b);
+				while (along(c + 1) < along(c)) c++;
+
+				double const hi = along(a), lo = along(c), wid = aside(b);
+				if ((hi - lo) * wid >= best) continue;
+				best = (hi - lo) * wid;
+				double const mid = 0.5 * (hi + lo);
+				cx = o.x + mid * dx + 0.5 * wid * nx; cy = o.y + mid * dy + 0.5 * wid * ny;
+				ux = dx; uy = dy; rx = 0.5 * (hi - lo); ry = 0.5 * wid;
+			}
+		}
+
+		// Welzl's algorithm (https://en.wikipedia.org/wiki/Smallest-circle_problem), in the iterative form,
+		// which takes expected linear time for the vertices in a random order.
+		void fit_circle()
+		{
+			std::shuffle(v.begin(), v.end(), std::minstd_rand{ static_cast<uint32_t>(v.size()) });
+			auto const outside = [&](point const& p) {
+				return std::hypot(p.x - cx, p.y - cy) > rx * (1 + 1e-12) + 1e-9;
+			};
+			auto const set = [&](double x, double y, double r) { cx = x; cy = y; rx = ry = r; };
+
+			int const n = static_cast<int>(v.size());
+			set(v[0].x, v[0].y, 0);
+			for (int i = 1; i < n; i++) {
+				if (!outside(v[i])) continue;
+				auto const& p = v[i];
+				set(p.x, p.y, 0);
+				for (int j = 0; j < i; j++) {
+					if (!outside(v[j])) continue;
+					auto const& q = v[j];
+					set(0.5 * (p.x + q.x), 0.5 * (p.y + q.y), 0.5 * std::hypot(q.x - p.x, q.y - p.y));
+					for (int k = 0; k < j; k++) {
+						if (!outside(v[k])) continue;
+						// the circumcircle of the three, which are never on a line.
+						auto const& r = v[k];
+						double const ax = q.x - p.x, ay = q.y - p.y, bx = r.x - p.x, by = r.y - p.y,
+							d = 2 * (ax * by - ay * bx), a2 = ax * ax + ay * ay, b2 = bx * bx + by * by,
+							ox = (by * a2 - ay * b2) / d, oy = (ax * b2 - bx * a2) / d;
+						set(p.x + ox, p.y + oy, std::hypot(ox, oy));
+					}
+				}
+			}
+			ux = 1; uy = 0;
+		}
+
+		// Khachiyan's algorithm for the minimum volume enclosing ellipsoid, by weighting the vertices
+		// until the ellipse of their covariance almost touches the farthest one,
+		// then scaled so that it contains all of them exactly. the weights of the nearest ones are
+		// also taken away as Todd and Yildirim did, which makes it converge far faster.
+		void fit_ellipse()
+		{
+			constexpr int max_iterations = 1000;
+			constexpr double tolerance = 1e-3;
+
+			// around the centroid, for the precision.
+			int const n = static_cast<int>(v.size());
+			double ox = 0, oy = 0;
+			for (auto const& p : v) { ox += p.x; oy += p.y; }
+			ox /= n; oy /= n;
+			for (auto& p : v) { p.x -= ox; p.y -= oy; }
+
+			weight.assign(n, 1.0 / n);
+			dist.resize(n);
+			double mx, my, sxx, sxy, syy;
+			auto const moments = [&] {
+				mx = my = sxx = sxy = syy = 0;
+				for (int i = 0; i < n; i++) {
+					double const w = weight[i], x = v[i].x, y = v[i].y;
+					mx += w * x; my += w * y;
+					sxx += w * x * x; sxy += w * x * y; syy += w * y * y;
+				}
+				sxx -= mx * mx; sxy -= mx * my; syy -= my * my;
+			};
+			// the squared Mahalanobis distances from the weighted mean, plus one,
+			// which equal the quadratic forms of the lifted points in three dimensions.
+			auto const distances = [&] {
+				double const det = sxx * syy - sxy * sxy;
+				for (int i = 0; i < n; i++) {
+					double const x = v[i].x - mx, y = v[i].y - my;
+					dist[i] = (syy * x * x - 2 * sxy * x * y + sxx * y * y) / det + 1;
+				}
+			};
+
+			for (int it = 0; it < max_iterations; it++) {
+				moments(); distances();
+				int far = 0, near = -1;
+				for (int i = 0; i < n; i++) {
+					if (dist[i] > dist[far]) far = i;
+					if (weight[i] > 0 && (near < 0 || dist[i] < dist[near])) near = i;
+				}
+				double const over = dist[far] / 3 - 1, under = 1 - dist[near] / 3;
+				if (over <= tolerance) break;
+
+				// moves the weight toward the farthest, or away from the nearest until it runs out.
+				int const j = over >= under ? far : near;
+				double step = (dist[j] - 3) / (3 * (dist[j] - 1));
+				if (j == near) step = std::max(step, -weight[j] / (1 - weight[j]));
+				for (auto& w : weight) w *= 1 - step;
+				weight[j] = std::max(weight[j] + step, 0.0);
+			}
+			moments(); distances();
+			double const scale = *std::max_element(dist.begin(), dist.end()) - 1;
+
+			// the axes are the eigenvectors of the covariance.
+			double const mean = 0.5 * (sxx + syy), diff = std::hypot(0.5 * (sxx - syy), sxy),
+				angle = 0.5 * std::atan2(2 * sxy, sxx - syy);
+			cx = mx + ox; cy = my + oy;
+			ux = std::cos(angle); uy = std::sin(angle);
+			rx = std::sqrt(scale * (mean + diff)); ry = std::sqrt(scale * std::max(mean - diff, 0.0));
+		}
+	};
+
+	// makes a function that evaluates the signed distance d from the shape at the center of each pixel
+	// on the given line, which is negative inside, and writes fn(d) into the alpha channel,
+	// where fn() is called only for d_in < d < d_out.
+	// the distance from an ellipse is approximated, exact on the axes and close near the boundary.
+	// the shape must outlive the returned function.
+	template<size_t dst_step>
+	auto enclosing_rasterizer(enclosing const& sh, i16* dst_buf, int dst_w, size_t dst_stride,
+		float d_in, float d_out, auto fn)
+	{
+		i16 const v_in = fn(d_in), v_out = fn(d_out);
+		return [=, &sh](int y) {
+			// the distances on the line, computed apart from fn() so the loop can be vectorized.
+			static thread_local std::vector<float> dist{};
+			dist.resize(std::max<size_t>(dist.size(), dst_w));
+
+			i16* const dst = dst_buf + y * dst_stride;
+			float const ux = static_cast<float>(sh.ux), uy = static_cast<float>(sh.uy),
+				rx = static_cast<float>(sh.rx), ry = static_cast<float>(sh.ry),
+				ox = 0.5f - static_cast<float>(sh.cx), oy = y + 0.5f - static_cast<float>(sh.cy);
+
+			// the pixels outside the rectangle around the shape, grown by d_out, are left out.
+			double x0 = 0, x1 = dst_w;
+			auto const clip = [&](double k, double c, double half) {
+				// |k * (x + ox) + c| <= half.
+				if (std::abs(k) < 1e-9) { if (std::abs(c) > half) x1 = x0; return; }
+				double const a = (-half - c) / k - ox, b = (half - c) / k - ox;
+				x0 = std::max(x0, std::min(a, b)); x1 = std::min(x1, std::max(a, b));
+			};
+			clip(ux, oy * uy, rx + d_out + 1);
+			clip(-uy, oy * ux, ry + d_out + 1);
+			int const l = std::clamp(static_cast<int>(std::floor(x0)), 0, dst_w),
+				r = std::clamp(static_cast<int>(std::ceil(x1)), l, dst_w);
+			for (int x = 0; x < l; x++) dst[x * dst_step] = v_out;
+			for (int x = r; x < dst_w; x++) dst[x * dst_step] = v_out;
+
+			float* const d = dist.data();
+			switch (sh.kind) {
+			case enclosing_kind::rectangle:
+				for (int x = l; x < r; x++) {
+					float const px = x + ox, u = std::abs(px * ux + oy * uy) - rx, w = std::abs(oy * ux - px * uy) - ry;
+					d[x] = std::sqrt(std::max(u, 0.0f) * std::max(u, 0.0f) + std::max(w, 0.0f) * std::max(w, 0.0f))
+						+ std::min(std::max(u, w), 0.0f);
+				}
+				break;
+			case enclosing_kind::circle:
+				for (int x = l; x < r; x++) {
+					float const px = x + ox;
+					d[x] = std::sqrt(px * px + oy * oy) - rx;
+				}
+				break;
+			default:
+			{
+				// k0 (k0 - 1) / k1, where k0 and k1 are the lengths of (u/rx, w/ry) and (u/rx^2, w/ry^2).
+				float const ix = 1 / std::max(rx, 1e-3f), iy = 1 / std::max(ry, 1e-3f),
+					ix2 = ix * ix, iy2 = iy * iy, lim = -std::min(rx, ry);
+				for (int x = l; x < r; x++) {
+					float const px = x + ox, u = px * ux + oy * uy, w = oy * ux - px * uy,
+						k0 = std::sqrt(u * u * ix2 + w * w * iy2), k1 = std::sqrt(u * u * ix2 * ix2 + w * w * iy2 * iy2);
+					d[x] = k1 > 0 ? std::max(k0 * (k0 - 1) / k1, lim) : lim;
+				}
+				break;
+			}
+			}
+			for (int x = l; x < r; x++)
+				dst[x * dst_step] = d[x] <= d_in ? v_in : d[x] >= d_out ? v_out : fn(d[x]);
+		};
+	}
+}
@@ -0,0 +1,128 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "multi_thread.hpp"
+#include "kernels.hpp"
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 凸包の逐次計算．
+////////////////////////////////
+namespace convex_closure
+{
+	// finds the same key points as find_key_points() from the lines given in order from the top,
+	// so the image needn't be kept as a whole, and the calculation overlaps the decoding of the rest.
+	// the left and right chains are built by Andrew's monotone chain as the lines come, in heap3 and heap4,
+	// where the quadrants are the parts of them before and after the left/right-most vertices.
+	class hull_builder {
+		hull& h;
+		int obj_w, obj_h, y = 0;
+
+		// the left chain, and the right one with x flipped, as pairs of x and y.
+		struct chain {
+			int* pts;
+			int count = 0;
+			// the first and the last vertices of the least x.
+			int first = 0, last = 0;
+
+			void add(int x, int y)
+			{
+				while (count >= 2) {
+					int const xa = pts[2 * count - 4], ya = pts[2 * count - 3],
+						xb = pts[2 * count - 2], yb = pts[2 * count - 1];
+					// keep the last point only if it's strictly outside.
+					if ((xb - xa) * (y - ya) < (x - xa) * (yb - ya)) break;
+					count--;
+				}
+				pts[2 * count] = x; pts[2 * count + 1] = y;
+				count++;
+
+				// those vertices never get removed by the lines below, nor do the ones before them.
+				if (count == 1 || x < pts[2 * first]) first = last = count - 1;
+				else if (x == pts[2 * first]) last = count - 1;
+			}
+		} left, right;
+		std::vector<std::pair<int, int>> spans;
+
+	public:
+		// `h` receives the key points, and must have the heap for the height `obj_h` or more.
+		hull_builder(hull& h, int obj_w, int obj_h)
+			: h{ h }, obj_w{ obj_w }, obj_h{ obj_h }, left{ h.heap3 }, right{ h.heap4 } {}
+
+		// the number of the lines taken so far.
+		int lines() const { return y; }
+
+		// takes the left/right-most pixels on the next line, which is empty if `l` > `r`.
+		void add_span(int l, int r)
+		{
+			if (y >= obj_h) return;
+			if (l <= r) {
+				left.add(l, y);
+				right.add(~r, y);
+			}
+			y++;
+		}
+
+		// scans the next `count` lines of `src_buf`, with the pixels whose alpha exceeds `threshold`.
+		// the lines are scanned in parallel, and then added in order.
+		template<size_t src_step, class src_t>
+		void add_lines(src_t const* src_buf, int count, size_t src_stride, std::type_identity_t<src_t> threshold)
+		{
+			count = std::clamp(count, 0, obj_h - y);
+			spans.resize(std::max<size_t>(spans.size(), count));
+			multi_thread(work_phase::scan, count * obj_w, [&](int thread_id, int thread_num) {
+				for (int i = thread_id; i < count; i += thread_num) {
+					auto const line = src_buf + i * src_stride;
+					int l, r;
+					if constexpr (kernels::can_find<src_t, src_step>) {
+						l = kernels::first_above<src_step>(line, obj_w, threshold);
+						r = l < obj_w ? l + kernels::last_above<src_step>(line + l * src_step, obj_w - l, threshold) : -1;
+					}
+					else {
+						for (l = 0; l < obj_w && !(line[l * src_step] > threshold); l++);
+						for (r = obj_w - 1; r >= l && !(line[r * src_step] > threshold); r--);
+					}
+					spans[i] = { l, r };
+				}
+			});
+			for (int i = 0; i < count; i++) add_span(spans[i].first, spans[i].second);
+		}
+
+		// sets the quadrants of `h` as find_key_points() would, treating the lines not given as transparent.
+		// returns false if there are no pixels.
+		bool finish()
+		{
+			if (left.count == 0) return false;
+
+			auto const set = [](key_points& quad, int* pts, int count) {
+				quad.key_pts = pts; quad.count = count;
+				quad.top = pts[1]; quad.btm = pts[2 * count - 1];
+			};
+			set(h.LT, left.pts, left.first + 1);
+			set(h.LB, left.pts + 2 * left.last, left.count - left.last);
+			set(h.RT, right.pts, right.first + 1);
+			set(h.RB, right.pts + 2 * right.last, right.count - right.last);
+			h.LT.x_map = h.LB.x_map = h.heap1;
+			h.RT.x_map = h.RB.x_map = h.heap1 + obj_h;
+			return true;
+		}
+	};
+}
@@ -0,0 +1,329 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "multi_thread.hpp"
+#include "kernels.hpp"
+#include "convex_closure.hpp"
+#include "calibration.hpp"
+#include "hull_cache.hpp"
+
+using namespace convex_closure;
+
+
+////////////////////////////////
+// 凸包のキャッシュ．
+////////////////////////////////
+constexpr char ini_section[] = "cache", ini_key_file[] = "file", ini_key_max_size[] = "max_size";
+constexpr int default_max_size = 256; // in MiB.
+
+// an entry of the file, followed by the key points of LT, LB, RT and RB as pairs of i16.
+struct record {
+	constexpr static uint32_t magic_id = 'C' | 'C' << 8 | 'H' << 16 | '1' << 24;
+	uint32_t magic, size; // size of the whole entry in bytes.
+	uint64_t hash;
+	int32_t w, h, threshold, draft;
+	int32_t count[4];
+	uint32_t checksum; // of the bytes above and the key points.
+	uint32_t reserved;
+};
+static_assert(sizeof(record) == 56);
+
+static uint64_t mix(uint64_t x)
+{
+	// the finalizer of MurmurHash3.
+	x ^= x >> 33; x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ull;
+	x ^= x >> 33;
+	return x;
+}
+
+// FNV-1a, for detecting broken entries.
+static uint32_t checksum(void const* data, size_t size, uint32_t h = 2166136261u)
+{
+	for (auto p = static_cast<uint8_t const*>(data), e = p + size; p < e; p++)
+		h = (h ^ *p) * 16777619u;
+	return h;
+}
+static uint32_t checksum(record const& rec, i16 const* pts)
+{
+	return checksum(pts, rec.size - sizeof(record), checksum(&rec, offsetof(record, checksum)));
+}
+
+// whether find_key_points() would find the key points in `h` in the alpha plane.
+// it holds if they're all on the pixels above `threshold`, and no such pixel is outside the polygon they make,
+// which needs scanning only the outside of the polygon, by the kernels.
+static bool matches(hull const& h, i16 const* alpha, int w, int ht, size_t stride, i16 threshold, bool draft)
+{
+	// the left and right chains as pairs of x and y, each from the top to the bottom.
+	std::vector<int> chain_l, chain_r;
+	for (auto const* q : { &h.LT, &h.LB, &h.RT, &h.RB }) {
+		bool const right = q == &h.RT || q == &h.RB;
+		for (int i = 0; i < q->count; i++) {
+			int const x = right ? ~q->key_pts[2 * i] : q->key_pts[2 * i], y = q->key_pts[2 * i + 1];
+			if (alpha[y * stride + 4 * x] <= threshold) return false;
+			(right ? chain_r : chain_l).insert((right ? chain_r : chain_l).end(), { x, y });
+		}
+	}
+
+	// the left/right-most x on the line y within the chain, walking from `i` as y only increases.
+	// returns INT_MAX/INT_MIN if the chain doesn't reach the line.
+	constexpr auto limit = []<bool left>(std::vector<int> const& c, size_t& i, int y) {
+		size_t const n = c.size() / 2;
+		while (i + 1 < n && c[2 * i + 3] < y) i++;
+		int lim = left ? INT_MAX : INT_MIN;
+		for (size_t j = i; j + 1 < n && c[2 * j + 1] <= y; j++) {
+			int const x0 = c[2 * j], y0 = c[2 * j + 1], x1 = c[2 * j + 2], y1 = c[2 * j + 3];
+			if (y1 < y) continue;
+			int x;
+			if (y1 == y0) x = left ? std::min(x0, x1) : std::max(x0, x1);
+			else {
+				// rounded inward.
+				int const num = (x1 - x0) * (y - y0), dy = y1 - y0;
+				x = x0 + (left ?
+					(num >= 0 ? (num + dy - 1) / dy : -(-num / dy)) :
+					(num >= 0 ? num / dy : -((-num + dy - 1) / dy)));
+			}
+			lim = left ? std::min(lim, x) : std::max(lim, x);
+		}
+		return lim;
+	};
+
+	// the lines skipped by the draft scan don't count.
+	int const step = draft && w >= coarse_min_size && ht >= coarse_min_size ? coarse_step : 1,
+		top = h.LT.top, btm = h.RB.btm;
+	for (bool const ok : multi_thread(work_phase::scan, (ht + step - 1) / step * w, [&](int thread_id, int thread_num) {
+		size_t il = 0, ir = 0;
+		for (int y = thread_id * step; y < ht; y += thread_num * step) {
+			auto const line = alpha + y * stride;
+			if (y < top || y > btm) {
+				if (kernels::first_above<4>(line, w, threshold) < w) return false;
+				continue;
+			}
+			int const l = limit.template operator()<true>(chain_l, il, y), r = limit.template operator()<false>(chain_r, ir, y);
+			if (l == INT_MAX || r == INT_MIN || r < l) return false;
+			if (kernels::first_above<4>(line, l, threshold) < l ||
+				kernels::last_above<4>(line + 4 * (r + 1), w - 1 - r, threshold) >= 0) return false;
+		}
+		return true;
+	})) if (!ok) return false;
+	return true;
+}
+
+namespace
+{
+	// the file opened for appending, and mapped for reading part by part as it grows, indexed by the hashes.
+	class cache_file {
+		std::mutex mtx;
+		HANDLE file = INVALID_HANDLE_VALUE;
+		uint64_t indexed = 0, max_size = 0;
+		std::unordered_multimap<uint64_t, uint8_t const*> index; // hash to the entry in one of the views.
+
+		// maps the part of the file appended since the last time, and indexes the entries in it.
+		// the views mapped before stay as they are, as the index points into them.
+		void refresh()
+		{
+			LARGE_INTEGER size;
+			if (::GetFileSizeEx(file, &size) == FALSE || static_cast<uint64_t>(size.QuadPart) < indexed + sizeof(record)) return;
+			uint64_t const end = size.QuadPart;
+
+			// a view starts at a multiple of the allocation granularity.
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			uint64_t const begin = indexed - indexed % info.dwAllocationGranularity;
+			HANDLE const mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr) return;
+			auto const view = static_cast<uint8_t const*>(::MapViewOfFile(mapping, FILE_MAP_READ,
+				static_cast<DWORD>(begin >> 32), static_cast<DWORD>(begin), static_cast<SIZE_T>(end - begin)));
+			::CloseHandle(mapping); // the view keeps it alive.
+			if (view == nullptr) return;
+
+			// an entry being written by another process may be incomplete yet,
+			// so stop there and retry later.
+			uint64_t const first = indexed;
+			while (indexed + sizeof(record) <= end) {
+				auto const entry = view + (indexed - begin);
+				record rec;
+				std::memcpy(&rec, entry, sizeof(rec));
+				if (rec.magic != record::magic_id || rec.size < sizeof(record) || rec.size % 4 != 0 ||
+					indexed + rec.size > end) break;
+				index.emplace(rec.hash, entry);
+				indexed += rec.size;
+			}
+			if (indexed == first) ::UnmapViewOfFile(view);
+		}
+
+	public:
+		bool is_open() const { return file != INVALID_HANDLE_VALUE; }
+
+		void open(char const* path, uint64_t max_size)
+		{
+			// FILE_APPEND_DATA without FILE_WRITE_DATA makes every write go to the end of the file at once.
+			file = ::CreateFileA(path, FILE_GENERIC_READ | FILE_APPEND_DATA,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			this->max_size = max_size;
+		}
+
+		bool load(hull_cache::key const& k, i16 const* alpha, size_t stride, hull& h)
+		{
+			// the entries are verified against the plane outside the lock, as they stay mapped.
+			std::vector<uint8_t const*> tried{};
+			for (int retry = 0; retry < 2; retry++) {
+				std::vector<uint8_t const*> entries{};
+				{
+					std::lock_guard lock{ mtx };
+					if (retry > 0) refresh();
+					auto const [begin, end] = index.equal_range(k.hash);
+					for (auto it = begin; it != end; ++it) {
+						if (std::ranges::find(tried, it->second) == tried.end()) entries.push_back(it->second);
+					}
+				}
+				for (auto const entry : entries) {
+					tried.push_back(entry);
+					record rec;
+					std::memcpy(&rec, entry, sizeof(rec));
+					if (rec.w != k.w || rec.h != k.h || rec.threshold != k.threshold || rec.draft != k.draft) continue;
+
+					// the counts should fit in the heap as find_key_points() would.
+					int const total = rec.count[0] + rec.count[1] + rec.count[2] + rec.count[3];
+					if (std::min({ rec.count[0], rec.count[1], rec.count[2], rec.count[3] }) < 1 ||
+						rec.count[0] + rec.count[1] > k.h + 1 || rec.count[2] + rec.count[3] > k.h + 1 ||
+						rec.size != sizeof(record) + 4 * total) continue;
+					auto const pts = reinterpret_cast<i16 const*>(entry + sizeof(record));
+					if (rec.checksum != checksum(rec, pts)) continue;
+
+					// every point should be in the image, going downward in each quadrant.
+					bool valid = true;
+					for (int i = 0, j = 0; i < 4; i++) {
+						for (int c = rec.count[i], y0 = 0; --c >= 0; j += 2) {
+							int const x = i < 2 ? pts[j] : ~pts[j], y = pts[j + 1];
+							valid &= 0 <= x && x < k.w && y0 <= y && y < k.h;
+							y0 = y;
+						}
+					}
+					if (!valid) continue;
+
+					auto const restore = [&](key_points& quad, int* key_pts, int count, i16 const* src) {
+						quad.key_pts = key_pts; quad.count = count;
+						for (int i = 0; i < 2 * count; i++) key_pts[i] = src[i];
+						quad.top = key_pts[1]; quad.btm = key_pts[2 * count - 1];
+					};
+					restore(h.LT, h.heap3, rec.count[0], pts);
+					restore(h.LB, h.heap3 + 2 * rec.count[0], rec.count[1], pts + 2 * rec.count[0]);
+					restore(h.RT, h.heap4, rec.count[2], pts + 2 * (rec.count[0] + rec.count[1]));
+					restore(h.RB, h.heap4 + 2 * rec.count[2], rec.count[3], pts + 2 * (rec.count[0] + rec.count[1] + rec.count[2]));
+					h.LT.x_map = h.LB.x_map = h.heap1;
+					h.RT.x_map = h.RB.x_map = h.heap1 + k.h;
+
+					// the key only tells some lines of the plane.
+					if (matches(h, alpha, k.w, k.h, stride, static_cast<i16>(k.threshold), k.draft != 0)) return true;
+				}
+			}
+			return false;
+		}
+
+		void store(hull_cache::key const& k, hull const& h)
+		{
+			// the coordinates are stored as i16.
+			if (k.w - 1 > std::numeric_limits<i16>::max() || k.h - 1 > std::numeric_limits<i16>::max()) return;
+
+			key_points const* const quads[] = { &h.LT, &h.LB, &h.RT, &h.RB };
+			std::vector<uint8_t> buf(sizeof(record));
+			record rec{
+				.magic = record::magic_id, .size = 0, .hash = k.hash,
+				.w = k.w, .h = k.h, .threshold = k.threshold, .draft = k.draft,
+			};
+			for (int i = 0; i < 4; i++) {
+				rec.count[i] = quads[i]->count;
+				auto const pts = quads[i]->key_pts;
+				for (int j = 0; j < 2 * quads[i]->count; j++) {
+					i16 const v = static_cast<i16>(pts[j]);
+					buf.insert(buf.end(), reinterpret_cast<uint8_t const*>(&v), reinterpret_cast<uint8_t const*>(&v + 1));
+				}
+			}
+			rec.size = static_cast<uint32_t>(buf.size());
+			rec.checksum = checksum(rec, reinterpret_cast<i16 const*>(buf.data() + sizeof(record)));
+			std::memcpy(buf.data(), &rec, sizeof(rec));
+
+			std::lock_guard lock{ mtx };
+			LARGE_INTEGER size;
+			if (::GetFileSizeEx(file, &size) == FALSE || static_cast<uint64_t>(size.QuadPart) + buf.size() > max_size) return;
+			DWORD written;
+			::WriteFile(file, buf.data(), static_cast<DWORD>(buf.size()), &written, nullptr);
+		}
+	};
+	cache_file cache{};
+}
+
+bool hull_cache::enabled()
+{
+	static bool const opened = [] {
+		auto const ini = calibration::ini_path();
+		std::string path;
+		path.resize_and_overwrite(MAX_PATH - 1, [&](auto p, auto c) {
+			return ::GetPrivateProfileStringA(ini_section, ini_key_file, "", p, static_cast<DWORD>(c + 1), ini.c_str());
+		});
+		if (path.empty()) return false;
+
+		// relative to the folder of the .ini.
+		if (!(path.starts_with("\\\\") || (path.size() >= 2 && path[1] == ':')))
+			path = ini.substr(0, ini.find_last_of("/\\") + 1) + path;
+		uint64_t const max_size = static_cast<uint64_t>(std::max(
+			static_cast<int>(::GetPrivateProfileIntA(ini_section, ini_key_max_size, default_max_size, ini.c_str())), 0)) << 20;
+		cache.open(path.c_str(), max_size);
+		return cache.is_open();
+	}();
+	return opened;
+}
+
+hull_cache::key hull_cache::make_key(i16 const* alpha, int w, int h, size_t stride, i16 threshold, bool draft)
+{
+	// the left/right-most pixels above `threshold` on every `coarse_step`-th line, found by the kernels
+	// as the coarse scan of find_key_points() does. each line is hashed with its position,
+	// and put together by xor, so the threads can take any of them.
+	constexpr uint64_t prime = 0x9e3779b97f4a7c15ull;
+	uint64_t hash = mix(static_cast<uint64_t>(w) << 32 | static_cast<uint32_t>(h));
+	for (auto part : multi_thread(work_phase::scan, (h + coarse_step - 1) / coarse_step * w, [&](int thread_id, int thread_num) {
+		uint64_t part = 0;
+		for (int y = thread_id * coarse_step; y < h; y += thread_num * coarse_step) {
+			auto const line = alpha + y * stride;
+			int const l = kernels::first_above<4>(line, w, threshold), r = l < w ? kernels::last_above<4>(line, w, threshold) : -1;
+			part ^= mix((static_cast<uint64_t>(l) << 32 | static_cast<uint32_t>(r)) ^ (y * prime));
+		}
+		return part;
+	})) hash ^= part;
+	return { hash, w, h, threshold, draft ? 1 : 0 };
+}
+
+bool hull_cache::load(key const& k, i16 const* alpha, size_t stride, hull& h)
+{
+	return enabled() && cache.load(k, alpha, stride, h);
+}
+
+void hull_cache::store(key const& k, hull const& h)
+{
+	if (enabled()) cache.store(k, h);
+}
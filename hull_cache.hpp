@@ -0,0 +1,50 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "convex_closure.hpp"
+
+
+////////////////////////////////
+// 凸包のキャッシュ．
+////////////////////////////////
+// key points found once are kept in a file, named by the key `file` in the section `[cache]`
+// of `ConvexClosure_S.ini`, and reused for the same alpha plane in later sessions.
+// the file is only appended to, so several processes, even on other machines, can share it.
+namespace hull_cache
+{
+	using i16 = convex_closure::i16;
+
+	// narrows down the inputs of find_key_points() to look for.
+	struct key {
+		uint64_t hash; // of some lines of the alpha plane.
+		int32_t w, h, threshold, draft;
+	};
+
+	// whether the file is specified. read once from the .ini.
+	bool enabled();
+
+	// hashes the ends of the shape on some lines of the alpha plane, `stride` i16 per row and 4 i16 per pixel,
+	// which is much cheaper than reading the entire plane.
+	key make_key(i16 const* alpha, int w, int h, size_t stride, i16 threshold, bool draft);
+
+	// restores the key points into `h` as find_key_points() would, if found.
+	// the entries of the key are verified against the plane, by scanning the outside of their polygons.
+	bool load(key const& k, i16 const* alpha, size_t stride, convex_closure::hull& h);
+
+	// appends the key points found by find_key_points(), unless the file has grown beyond the limit,
+	// or the plane is too large for the coordinates to fit in i16.
+	void store(key const& k, convex_closure::hull const& h);
+}
@@ -0,0 +1,181 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "kernels.hpp"
+#include "calibration.hpp"
+
+using namespace kernels;
+
+
+////////////////////////////////
+// 命令セットごとの処理の切り替え．
+////////////////////////////////
+namespace kernels
+{
+	// defined in kernels_*.cpp, each compiled for its own instruction set.
+	extern table const sse41_table, avx2_table, avx512bw_table;
+
+	constexpr table scalar_table = {
+		.find_first = &scalar::find_first,
+		.find_last = &scalar::find_last,
+		.find_first_a8 = &scalar::find_first8<1>,
+		.find_last_a8 = &scalar::find_last8<1>,
+		.find_first_rgba8 = &scalar::find_first8<4>,
+		.find_last_rgba8 = &scalar::find_last8<4>,
+		.fill_alpha = &scalar::fill_alpha,
+		.paint_color = &scalar::paint_any<false>,
+		.paint_pattern = &scalar::paint_any<true>,
+		.blend_color = &scalar::blend_any<false>,
+		.blend_pattern = &scalar::blend_any<true>,
+	};
+
+	table const* const tables[] = { &scalar_table, &sse41_table, &avx2_table, &avx512bw_table };
+	static_assert(std::size(tables) == static_cast<size_t>(isa::count));
+
+	constinit table active = scalar_table;
+	constinit isa active_isa = isa::scalar;
+}
+
+isa kernels::detect()
+{
+	static isa const best = [] {
+		int regs[4]{};
+		::__cpuid(regs, 0);
+		int const max_leaf = regs[0];
+
+		::__cpuid(regs, 1);
+		int const ecx1 = regs[2];
+		if ((ecx1 & (1 << 19)) == 0) return isa::scalar;
+
+		// AVX and above need the support by the OS for the wider registers.
+		constexpr int osxsave = 1 << 27, avx = 1 << 28;
+		if ((ecx1 & (osxsave | avx)) != (osxsave | avx) || max_leaf < 7) return isa::sse41;
+		uint64_t const xcr0 = ::_xgetbv(0);
+		::__cpuidex(regs, 7, 0);
+		int const ebx7 = regs[1];
+
+		constexpr uint64_t ymm_state = 0x06, zmm_state = 0xe6;
+		if ((xcr0 & ymm_state) != ymm_state || (ebx7 & (1 << 5)) == 0) return isa::sse41;
+
+		constexpr int avx512f = 1 << 16, avx512bw = 1 << 30;
+		if ((xcr0 & zmm_state) != zmm_state || (ebx7 & (avx512f | avx512bw)) != (avx512f | avx512bw)) return isa::avx2;
+		return isa::avx512bw;
+	}();
+	return best;
+}
+
+bool kernels::select(isa variant)
+{
+	if (variant < isa::scalar || variant > detect()) return false;
+	active = *tables[static_cast<size_t>(variant)];
+	active_isa = variant;
+	return true;
+}
+
+bool kernels::verify(isa variant)
+{
+	if (variant < isa::scalar || variant > detect()) return false;
+	auto const& ref = *tables[static_cast<size_t>(isa::scalar)], & var = *tables[static_cast<size_t>(variant)];
+
+	// pseudo-random pixels, crowded around the boundaries between the cases.
+	constexpr int len = 64;
+	uint32_t seed = 0x2545f491;
+	auto const rand = [&] { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return seed; };
+	auto const rand_alpha = [&]() -> i16 {
+		switch (rand() % 4) {
+		case 0: return 0;
+		case 1: return max_alpha;
+		default: return static_cast<i16>(rand() % (max_alpha + 1));
+		}
+	};
+	auto const rand_color = [&] { return static_cast<i16>(static_cast<int>(rand() % (2 * max_alpha + 1)) - max_alpha); };
+	std::vector<pixel> src(len), col(len), back(len), dst1(len), dst2(len);
+	for (int i = 0; i < len; i++) {
+		src[i] = { rand_color(), rand_color(), rand_color(), rand_alpha() };
+		col[i] = { rand_color(), rand_color(), rand_color(), rand_alpha() };
+		back[i] = { rand_color(), rand_color(), rand_color(), rand_alpha() };
+	}
+	std::vector<i16> back1(len);
+	for (int i = 0; i < len; i++) back1[i] = back[i].a;
+	std::vector<uint8_t> bytes(4 * len);
+	for (auto& b : bytes) b = rand() % 4 == 0 ? 0 : rand() % 4 == 0 ? 255 : static_cast<uint8_t>(rand());
+
+	auto const same = [&] { return std::memcmp(dst1.data(), dst2.data(), sizeof(pixel) * len) == 0; };
+	for (int n = 0; n <= len; n++) {
+		for (i16 threshold : { i16{ 0 }, i16{ max_alpha / 2 }, i16{ max_alpha - 1 } }) {
+			if (ref.find_first(&src[0].a, n, threshold) != var.find_first(&src[0].a, n, threshold) ||
+				ref.find_last(&src[0].a, n, threshold) != var.find_last(&src[0].a, n, threshold)) return false;
+		}
+		for (uint8_t threshold : { uint8_t{ 0 }, uint8_t{ 127 }, uint8_t{ 128 }, uint8_t{ 254 } }) {
+			if (ref.find_first_a8(bytes.data(), 4 * n, threshold) != var.find_first_a8(bytes.data(), 4 * n, threshold) ||
+				ref.find_last_a8(bytes.data(), 4 * n, threshold) != var.find_last_a8(bytes.data(), 4 * n, threshold) ||
+				ref.find_first_rgba8(&bytes[3], n, threshold) != var.find_first_rgba8(&bytes[3], n, threshold) ||
+				ref.find_last_rgba8(&bytes[3], n, threshold) != var.find_last_rgba8(&bytes[3], n, threshold)) return false;
+		}
+
+		dst1 = src; dst2 = src;
+		ref.fill_alpha(&dst1[0].a, n, max_alpha); var.fill_alpha(&dst2[0].a, n, max_alpha);
+		if (!same()) return false;
+
+		for (int alpha : { 0, max_alpha / 3, max_alpha }) {
+			for (auto [b, step] : { std::pair{ &back[0].a, size_t{ 4 } }, { back1.data(), size_t{ 1 } } }) {
+				ref.paint_color(dst1.data(), b, step, col.data(), n, alpha);
+				var.paint_color(dst2.data(), b, step, col.data(), n, alpha);
+				if (!same()) return false;
+				ref.paint_pattern(dst1.data(), b, step, col.data(), n, alpha);
+				var.paint_pattern(dst2.data(), b, step, col.data(), n, alpha);
+				if (!same()) return false;
+
+				for (int f_alpha : { 0, max_alpha / 2, max_alpha }) {
+					ref.blend_color(dst1.data(), src.data(), b, step, col.data(), n, alpha, f_alpha);
+					var.blend_color(dst2.data(), src.data(), b, step, col.data(), n, alpha, f_alpha);
+					if (!same()) return false;
+					ref.blend_pattern(dst1.data(), src.data(), b, step, col.data(), n, alpha, f_alpha);
+					var.blend_pattern(dst2.data(), src.data(), b, step, col.data(), n, alpha, f_alpha);
+					if (!same()) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void kernels::init()
+{
+	isa variant = detect();
+
+	// lower it as specified, for testing.
+	std::string name(16, '\0');
+	name.resize(::GetPrivateProfileStringA("cpu", "isa", "", name.data(), static_cast<DWORD>(name.size()),
+		calibration::ini_path().c_str()));
+	for (size_t i = 0; i < std::size(isa_names); i++) {
+		if (name == isa_names[i]) {
+			variant = std::min(variant, static_cast<isa>(i));
+			break;
+		}
+	}
+
+	while (variant > isa::scalar && !verify(variant))
+		variant = static_cast<isa>(static_cast<int32_t>(variant) - 1);
+	select(variant);
+}
@@ -0,0 +1,230 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+
+////////////////////////////////
+// 命令セットごとの処理の切り替え．
+////////////////////////////////
+// the innermost loops are provided in variants for each instruction set,
+// one of which is chosen at the start by the features of the CPU.
+namespace kernels
+{
+	using i16 = int16_t;
+	constexpr int log2_max_alpha = 12, max_alpha = 1 << log2_max_alpha;
+
+	// same layout as ExEdit::PixelYCA.
+	struct pixel { i16 y, cb, cr, a; };
+
+	enum class isa : int32_t {
+		scalar,
+		sse41,
+		avx2,
+		avx512bw,
+		count,
+	};
+	constexpr char const* isa_names[] = { "scalar", "sse41", "avx2", "avx512bw" };
+	static_assert(std::size(isa_names) == static_cast<size_t>(isa::count));
+
+	struct table {
+		// the index of the first/last of `n` alpha values, 4 i16 apart, that exceeds `threshold`.
+		// returns n/-1 if none.
+		int (*find_first)(i16 const* alpha, int n, i16 threshold);
+		int (*find_last)(i16 const* alpha, int n, i16 threshold);
+
+		// the same for 8-bit alpha values, either packed, or the last of every 4 bytes as in RGBA.
+		int (*find_first_a8)(uint8_t const* alpha, int n, uint8_t threshold);
+		int (*find_last_a8)(uint8_t const* alpha, int n, uint8_t threshold);
+		int (*find_first_rgba8)(uint8_t const* alpha, int n, uint8_t threshold);
+		int (*find_last_rgba8)(uint8_t const* alpha, int n, uint8_t threshold);
+
+		// sets `n` alpha values, 4 i16 apart, to `val`.
+		void (*fill_alpha)(i16* alpha, int n, i16 val);
+
+		// paints `n` pixels by the color with the alpha of `back` times `alpha`,
+		// or blends it behind `src` whose alpha is multiplied by `f_alpha`.
+		// `back` is at every `back_step` i16, either 1 or 4, where the latter means the alpha channel of pixels.
+		// `src` may be the same as `dst`.
+		// the *_color variants take a single color, and *_pattern ones take `n` pixels whose alpha also applies.
+		void (*paint_color)(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha);
+		void (*paint_pattern)(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha);
+		void (*blend_color)(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+			pixel const* col, int n, int alpha, int f_alpha);
+		void (*blend_pattern)(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+			pixel const* col, int n, int alpha, int f_alpha);
+	};
+
+	// the values of `alpha` and `f_alpha` the blending kernels are specialized for,
+	// 0 and max_alpha, the defaults and the extremes of the transparency, and `variable` for the rest.
+	constexpr int variable = -1;
+
+	// calls `func` with `value` as std::integral_constant if it's one of the specialized, or `variable` otherwise.
+	template<class Func>
+	inline void specialize(int value, Func&& func)
+	{
+		if (value == 0) func(std::integral_constant<int, 0>{});
+		else if (value == max_alpha) func(std::integral_constant<int, max_alpha>{});
+		else func(std::integral_constant<int, variable>{});
+	}
+
+	// all the variants, indexed by isa.
+	extern table const* const tables[static_cast<size_t>(isa::count)];
+
+	// the one in use, scalar until init() is called.
+	extern table active;
+	extern isa active_isa;
+
+	// whether the alpha values of type T, each `step` values apart, can be searched by the kernels.
+	template<class T, size_t step>
+	constexpr bool can_find = std::is_same_v<T, i16> ? step == 4 : std::is_same_v<T, uint8_t> && (step == 1 || step == 4);
+
+	// find_first() or find_last() of the active variant, chosen by the layout of the alpha values.
+	template<size_t step, class T>
+	inline int first_above(T const* alpha, int n, std::type_identity_t<T> threshold)
+	{
+		static_assert(can_find<T, step>);
+		if constexpr (std::is_same_v<T, i16>) return active.find_first(alpha, n, threshold);
+		else if constexpr (step == 1) return active.find_first_a8(alpha, n, threshold);
+		else return active.find_first_rgba8(alpha, n, threshold);
+	}
+	template<size_t step, class T>
+	inline int last_above(T const* alpha, int n, std::type_identity_t<T> threshold)
+	{
+		static_assert(can_find<T, step>);
+		if constexpr (std::is_same_v<T, i16>) return active.find_last(alpha, n, threshold);
+		else if constexpr (step == 1) return active.find_last_a8(alpha, n, threshold);
+		else return active.find_last_rgba8(alpha, n, threshold);
+	}
+
+	// the best instruction set available on this CPU.
+	isa detect();
+
+	// whether the variant gives the same results as the scalar one.
+	bool verify(isa variant);
+
+	// chooses the variant by detect(), unless overridden by the key `isa` in the section `[cpu]`
+	// of `ConvexClosure_S.ini`, which is for testing. variants failing verify() fall back to the lower ones.
+	void init();
+
+	// switches to the variant if it's available. returns false otherwise.
+	bool select(isa variant);
+
+	// reference implementations, also used for the remainders of the vectorized loops.
+	namespace scalar
+	{
+		inline int find_first(i16 const* alpha, int n, i16 threshold)
+		{
+			for (int i = 0; i < n; i++, alpha += 4)
+				if (*alpha > threshold) return i;
+			return n;
+		}
+		inline int find_last(i16 const* alpha, int n, i16 threshold)
+		{
+			alpha += 4 * n;
+			for (int i = n; --i >= 0;)
+				if (*(alpha -= 4) > threshold) return i;
+			return -1;
+		}
+		template<int step>
+		inline int find_first8(uint8_t const* alpha, int n, uint8_t threshold)
+		{
+			for (int i = 0; i < n; i++, alpha += step)
+				if (*alpha > threshold) return i;
+			return n;
+		}
+		template<int step>
+		inline int find_last8(uint8_t const* alpha, int n, uint8_t threshold)
+		{
+			alpha += step * n;
+			for (int i = n; --i >= 0;)
+				if (*(alpha -= step) > threshold) return i;
+			return -1;
+		}
+		inline void fill_alpha(i16* alpha, int n, i16 val)
+		{
+			for (; --n >= 0; alpha += 4) *alpha = val;
+		}
+
+		// (k * v) >> log2_max_alpha as i16, where k is `fixed` unless it's `variable`.
+		template<int fixed>
+		inline i16 scale(int k, i16 v)
+		{
+			static_assert(fixed == variable || fixed == 0 || fixed == max_alpha);
+			if constexpr (fixed == variable) return static_cast<i16>((k * v) >> log2_max_alpha);
+			else if constexpr (fixed == 0) return 0;
+			else return v;
+		}
+
+		template<bool pattern, int fixed_alpha = variable>
+		void paint(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha)
+		{
+			for (; --n >= 0; dst++, back += back_step) {
+				i16 A = scale<fixed_alpha>(alpha, *back);
+				if constexpr (pattern) {
+					if (A <= 0) *dst = { .a = 0 };
+					else {
+						A = (A * col->a) >> log2_max_alpha;
+						*dst = { .y = col->y, .cb = col->cb, .cr = col->cr, .a = A };
+					}
+					col++;
+				}
+				else *dst = { .y = col->y, .cb = col->cb, .cr = col->cr, .a = A };
+			}
+		}
+
+		template<bool pattern, int fixed_alpha = variable, int fixed_f_alpha = variable>
+		void blend(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+			pixel const* col, int n, int alpha, int f_alpha)
+		{
+			for (; --n >= 0; dst++, src++, back += back_step, col += pattern ? 1 : 0) {
+				i16 a = scale<fixed_f_alpha>(f_alpha, src->a);
+				if (a >= max_alpha) { *dst = *src; continue; }
+
+				i16 A = scale<fixed_alpha>(alpha, *back);
+				if (A <= 0) { *dst = { .y = src->y, .cb = src->cb, .cr = src->cr, .a = a }; continue; }
+
+				if constexpr (pattern) A = (A * col->a) >> log2_max_alpha;
+				if (a <= 0) { *dst = { .y = col->y, .cb = col->cb, .cr = col->cr, .a = A }; continue; }
+
+				A = ((max_alpha - a) * A) >> log2_max_alpha;
+				*dst = {
+					.y  = static_cast<i16>((a * src->y  + A * col->y ) / (a + A)),
+					.cb = static_cast<i16>((a * src->cb + A * col->cb) / (a + A)),
+					.cr = static_cast<i16>((a * src->cr + A * col->cr) / (a + A)),
+					.a  = static_cast<i16>(a + A),
+				};
+			}
+		}
+
+		template<bool pattern>
+		void paint_any(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha)
+		{
+			specialize(alpha, [&](auto fa) {
+				paint<pattern, decltype(fa)::value>(dst, back, back_step, col, n, alpha);
+			});
+		}
+		template<bool pattern>
+		void blend_any(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+			pixel const* col, int n, int alpha, int f_alpha)
+		{
+			specialize(alpha, [&](auto fa) { specialize(f_alpha, [&](auto ff) {
+				blend<pattern, decltype(fa)::value, decltype(ff)::value>(dst, src, back, back_step, col, n, alpha, f_alpha);
+			}); });
+		}
+	}
+}
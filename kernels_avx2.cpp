@@ -0,0 +1,287 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <bit>
+
+#include <immintrin.h>
+
+#include "kernels.hpp"
+
+using namespace kernels;
+
+
+////////////////////////////////
+// AVX2 版．
+////////////////////////////////
+namespace
+{
+	// 8 pixels, each channel in 32-bit lanes,
+	// in the order of 0, 1, 4, 5, 2, 3, 6, 7 as the shuffles work within 128-bit lanes.
+	struct octet { __m256i y, cb, cr, a; };
+
+	template<int imm>
+	inline __m256i pick(__m256i p, __m256i q) {
+		return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(p), _mm256_castsi256_ps(q), imm));
+	}
+	// as static_cast<i16>, extended back to 32 bits.
+	inline __m256i trunc16(__m256i v) { return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16); }
+	// (a * b) >> log2_max_alpha, truncated to i16.
+	inline __m256i mul_alpha(__m256i a, __m256i b) {
+		return trunc16(_mm256_srai_epi32(_mm256_mullo_epi32(a, b), log2_max_alpha));
+	}
+	inline __m256i select(__m256i mask, __m256i t, __m256i f) { return _mm256_blendv_epi8(f, t, mask); }
+
+	// mul_alpha() by k, where k is `fixed` unless it's `variable`.
+	template<int fixed>
+	inline __m256i scale(__m256i k, __m256i v)
+	{
+		if constexpr (fixed == variable) return mul_alpha(k, v);
+		else if constexpr (fixed == 0) return _mm256_setzero_si256();
+		else return v;
+	}
+
+	inline octet load(pixel const* p)
+	{
+		__m256i const
+			p0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)),
+			p1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 4));
+		// lower and upper halves of each 32 bits, that is, (y, cr) and (cb, a).
+		__m256i const l0 = trunc16(p0), h0 = _mm256_srai_epi32(p0, 16),
+			l1 = trunc16(p1), h1 = _mm256_srai_epi32(p1, 16);
+		return {
+			pick<_MM_SHUFFLE(2, 0, 2, 0)>(l0, l1), pick<_MM_SHUFFLE(2, 0, 2, 0)>(h0, h1),
+			pick<_MM_SHUFFLE(3, 1, 3, 1)>(l0, l1), pick<_MM_SHUFFLE(3, 1, 3, 1)>(h0, h1),
+		};
+	}
+	inline void store(pixel* p, __m256i y, __m256i cb, __m256i cr, __m256i a)
+	{
+		__m256i const
+			e = _mm256_blend_epi16(y, _mm256_slli_epi32(cb, 16), 0xaa),
+			o = _mm256_blend_epi16(cr, _mm256_slli_epi32(a, 16), 0xaa);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_unpacklo_epi32(e, o));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 4), _mm256_unpackhi_epi32(e, o));
+	}
+	template<size_t back_step>
+	inline __m256i load_back(i16 const* back)
+	{
+		if constexpr (back_step == 1)
+			return _mm256_permutevar8x32_epi32(
+				_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(back))),
+				_mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+		else return load(reinterpret_cast<pixel const*>(back - 3)).a;
+	}
+	// n / d truncated toward zero, which is exact in double as long as both are far less than 2^52.
+	inline __m256i div(__m256i n, __m256i d)
+	{
+		__m128i const
+			lo = _mm256_cvttpd_epi32(_mm256_div_pd(
+				_mm256_cvtepi32_pd(_mm256_castsi256_si128(n)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(d)))),
+			hi = _mm256_cvttpd_epi32(_mm256_div_pd(
+				_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(d, 1))));
+		return _mm256_set_m128i(hi, lo);
+	}
+
+	// bits of _mm256_movemask_epi8() for the alpha of 8 pixels, one for each.
+	constexpr uint64_t alpha_bits = 0x8080'8080'8080'8080;
+	inline uint64_t above(i16 const* p, __m256i threshold)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi16(
+			_mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)), threshold)))) |
+			(static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi16(
+			_mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 16)), threshold)))) << 32)) & alpha_bits;
+	}
+
+	int find_first(i16 const* alpha, int n, i16 threshold)
+	{
+		__m256i const t = _mm256_set1_epi16(threshold);
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			if (uint64_t const hit = above(alpha - 3 + 4 * i, t); hit != 0)
+				return i + std::countr_zero(hit) / 8;
+		}
+		return i + scalar::find_first(alpha + 4 * i, n - i, threshold);
+	}
+
+	int find_last(i16 const* alpha, int n, i16 threshold)
+	{
+		__m256i const t = _mm256_set1_epi16(threshold);
+		int i = n;
+		for (; i >= 8; i -= 8) {
+			if (uint64_t const hit = above(alpha - 3 + 4 * (i - 8), t); hit != 0)
+				return i - 8 + (63 - std::countl_zero(hit)) / 8;
+		}
+		return scalar::find_last(alpha, i, threshold);
+	}
+
+	// bits of _mm256_movemask_epi8() for 64 bytes exceeding `threshold` as unsigned, whose top bit is flipped.
+	inline uint64_t above8(uint8_t const* p, __m256i threshold)
+	{
+		__m256i const flip = _mm256_set1_epi8(-128);
+		return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_xor_si256(
+			_mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)), flip), threshold)))) |
+			(static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_xor_si256(
+			_mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 32)), flip), threshold)))) << 32);
+	}
+
+	// 8-bit alpha values `step` bytes apart, where 4 means the last byte of each pixel.
+	template<int step>
+	int find_first8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint64_t bits = step == 1 ? ~uint64_t{ 0 } : 0x8888'8888'8888'8888;
+		constexpr int count = 64 / step;
+		__m256i const t = _mm256_set1_epi8(static_cast<char>(threshold ^ 0x80));
+		int i = 0;
+		for (; i + count <= n; i += count) {
+			if (uint64_t const hit = above8(alpha - (step - 1) + step * i, t) & bits; hit != 0)
+				return i + std::countr_zero(hit) / step;
+		}
+		return i + scalar::find_first8<step>(alpha + step * i, n - i, threshold);
+	}
+
+	template<int step>
+	int find_last8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint64_t bits = step == 1 ? ~uint64_t{ 0 } : 0x8888'8888'8888'8888;
+		constexpr int count = 64 / step;
+		__m256i const t = _mm256_set1_epi8(static_cast<char>(threshold ^ 0x80));
+		int i = n;
+		for (; i >= count; i -= count) {
+			if (uint64_t const hit = above8(alpha - (step - 1) + step * (i - count), t) & bits; hit != 0)
+				return i - count + (63 - std::countl_zero(hit)) / step;
+		}
+		return scalar::find_last8<step>(alpha, i, threshold);
+	}
+
+	void fill_alpha(i16* alpha, int n, i16 val)
+	{
+		__m256i const v = _mm256_set1_epi16(val);
+		for (; n >= 4; n -= 4, alpha += 16) {
+			auto* const p = reinterpret_cast<__m256i*>(alpha - 3);
+			_mm256_storeu_si256(p, _mm256_blend_epi16(_mm256_loadu_si256(p), v, 0x88));
+		}
+		scalar::fill_alpha(alpha, n, val);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha>
+	void paint(pixel* dst, i16 const* back, pixel const* col, int n, int alpha)
+	{
+		__m256i const v_alpha = _mm256_set1_epi32(alpha), one = _mm256_set1_epi32(1);
+		octet c{};
+		if constexpr (!pattern)
+			c = { _mm256_set1_epi32(col->y), _mm256_set1_epi32(col->cb), _mm256_set1_epi32(col->cr), _mm256_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 8 <= n; i += 8, dst += 8, back += 8 * back_step) {
+			__m256i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+			if constexpr (pattern) {
+				c = load(col); col += 8;
+				__m256i const clear = _mm256_cmpgt_epi32(one, A);
+				A = mul_alpha(A, c.a);
+				store(dst, _mm256_andnot_si256(clear, c.y), _mm256_andnot_si256(clear, c.cb),
+					_mm256_andnot_si256(clear, c.cr), _mm256_andnot_si256(clear, A));
+			}
+			else store(dst, c.y, c.cb, c.cr, A);
+		}
+		scalar::paint<pattern, fixed_alpha>(dst, back, back_step, col, n - i, alpha);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha, int fixed_f_alpha>
+	void blend(pixel* dst, pixel const* src, i16 const* back, pixel const* col, int n, int alpha, int f_alpha)
+	{
+		__m256i const v_alpha = _mm256_set1_epi32(alpha), v_f_alpha = _mm256_set1_epi32(f_alpha),
+			v_max = _mm256_set1_epi32(max_alpha), one = _mm256_set1_epi32(1);
+		octet c{};
+		if constexpr (!pattern)
+			c = { _mm256_set1_epi32(col->y), _mm256_set1_epi32(col->cb), _mm256_set1_epi32(col->cr), _mm256_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 8 <= n; i += 8, dst += 8, src += 8, back += 8 * back_step) {
+			octet const s = load(src);
+			__m256i const a = scale<fixed_f_alpha>(v_f_alpha, s.a);
+			__m256i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+
+			// the cases in the order of precedence.
+			__m256i const
+				opaque = _mm256_cmpgt_epi32(a, _mm256_sub_epi32(v_max, one)),
+				no_back = _mm256_cmpgt_epi32(one, A);
+			if constexpr (pattern) {
+				c = load(col); col += 8;
+				A = mul_alpha(A, c.a);
+			}
+			__m256i const no_src = _mm256_cmpgt_epi32(one, a);
+
+			if constexpr (fixed_alpha == 0) {
+				// nothing behind, so the source only.
+				store(dst, s.y, s.cb, s.cr, select(opaque, s.a, a));
+				continue;
+			}
+			if constexpr (fixed_f_alpha == 0) {
+				// nothing in front, so the color only except where nothing behind either.
+				store(dst, select(no_back, s.y, c.y), select(no_back, s.cb, c.cb), select(no_back, s.cr, c.cr),
+					select(no_back, a, A));
+				continue;
+			}
+
+			__m256i const B = mul_alpha(_mm256_sub_epi32(v_max, a), A), sum = _mm256_add_epi32(a, B);
+			__m256i
+				y  = div(_mm256_add_epi32(_mm256_mullo_epi32(a, s.y ), _mm256_mullo_epi32(B, c.y )), sum),
+				cb = div(_mm256_add_epi32(_mm256_mullo_epi32(a, s.cb), _mm256_mullo_epi32(B, c.cb)), sum),
+				cr = div(_mm256_add_epi32(_mm256_mullo_epi32(a, s.cr), _mm256_mullo_epi32(B, c.cr)), sum),
+				alp = sum;
+
+			y = select(no_src, c.y, y); cb = select(no_src, c.cb, cb); cr = select(no_src, c.cr, cr);
+			alp = select(no_src, A, alp);
+			y = select(no_back, s.y, y); cb = select(no_back, s.cb, cb); cr = select(no_back, s.cr, cr);
+			alp = select(no_back, a, alp);
+			y = select(opaque, s.y, y); cb = select(opaque, s.cb, cb); cr = select(opaque, s.cr, cr);
+			alp = select(opaque, s.a, alp);
+			store(dst, y, cb, cr, alp);
+		}
+		scalar::blend<pattern, fixed_alpha, fixed_f_alpha>(dst, src, back, back_step, col, n - i, alpha, f_alpha);
+	}
+
+	template<bool pattern>
+	void paint_any(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha)
+	{
+		specialize(alpha, [&](auto fa) {
+			constexpr int fixed_alpha = decltype(fa)::value;
+			if (back_step == 1) paint<pattern, 1, fixed_alpha>(dst, back, col, n, alpha);
+			else paint<pattern, 4, fixed_alpha>(dst, back, col, n, alpha);
+		});
+	}
+	template<bool pattern>
+	void blend_any(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+		pixel const* col, int n, int alpha, int f_alpha)
+	{
+		specialize(alpha, [&](auto fa) { specialize(f_alpha, [&](auto ff) {
+			constexpr int fixed_alpha = decltype(fa)::value, fixed_f_alpha = decltype(ff)::value;
+			if (back_step == 1) blend<pattern, 1, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+			else blend<pattern, 4, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+		}); });
+	}
+}
+
+namespace kernels
+{
+	extern table const avx2_table = {
+		.find_first = &find_first,
+		.find_last = &find_last,
+		.find_first_a8 = &find_first8<1>,
+		.find_last_a8 = &find_last8<1>,
+		.find_first_rgba8 = &find_first8<4>,
+		.find_last_rgba8 = &find_last8<4>,
+		.fill_alpha = &fill_alpha,
+		.paint_color = &paint_any<false>,
+		.paint_pattern = &paint_any<true>,
+		.blend_color = &blend_any<false>,
+		.blend_pattern = &blend_any<true>,
+	};
+}
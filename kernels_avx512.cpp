@@ -0,0 +1,275 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <bit>
+
+#include <immintrin.h>
+
+#include "kernels.hpp"
+
+using namespace kernels;
+
+
+////////////////////////////////
+// AVX-512BW 版．
+////////////////////////////////
+namespace
+{
+	// 16 pixels, each channel in 32-bit lanes, in the order of
+	// 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15 as the shuffles work within 128-bit lanes.
+	struct hextet { __m512i y, cb, cr, a; };
+
+	template<int imm>
+	inline __m512i pick(__m512i p, __m512i q) {
+		return _mm512_castps_si512(_mm512_shuffle_ps(_mm512_castsi512_ps(p), _mm512_castsi512_ps(q), imm));
+	}
+	// as static_cast<i16>, extended back to 32 bits.
+	inline __m512i trunc16(__m512i v) { return _mm512_srai_epi32(_mm512_slli_epi32(v, 16), 16); }
+	// (a * b) >> log2_max_alpha, truncated to i16.
+	inline __m512i mul_alpha(__m512i a, __m512i b) {
+		return trunc16(_mm512_srai_epi32(_mm512_mullo_epi32(a, b), log2_max_alpha));
+	}
+	inline __m512i select(__mmask16 mask, __m512i t, __m512i f) { return _mm512_mask_blend_epi32(mask, f, t); }
+
+	// mul_alpha() by k, where k is `fixed` unless it's `variable`.
+	template<int fixed>
+	inline __m512i scale(__m512i k, __m512i v)
+	{
+		if constexpr (fixed == variable) return mul_alpha(k, v);
+		else if constexpr (fixed == 0) return _mm512_setzero_si512();
+		else return v;
+	}
+
+	inline hextet load(pixel const* p)
+	{
+		__m512i const
+			p0 = _mm512_loadu_si512(p),
+			p1 = _mm512_loadu_si512(p + 8);
+		// lower and upper halves of each 32 bits, that is, (y, cr) and (cb, a).
+		__m512i const l0 = trunc16(p0), h0 = _mm512_srai_epi32(p0, 16),
+			l1 = trunc16(p1), h1 = _mm512_srai_epi32(p1, 16);
+		return {
+			pick<_MM_SHUFFLE(2, 0, 2, 0)>(l0, l1), pick<_MM_SHUFFLE(2, 0, 2, 0)>(h0, h1),
+			pick<_MM_SHUFFLE(3, 1, 3, 1)>(l0, l1), pick<_MM_SHUFFLE(3, 1, 3, 1)>(h0, h1),
+		};
+	}
+	inline void store(pixel* p, __m512i y, __m512i cb, __m512i cr, __m512i a)
+	{
+		__m512i const
+			e = _mm512_mask_blend_epi16(0xaaaa'aaaa, y, _mm512_slli_epi32(cb, 16)),
+			o = _mm512_mask_blend_epi16(0xaaaa'aaaa, cr, _mm512_slli_epi32(a, 16));
+		_mm512_storeu_si512(p, _mm512_unpacklo_epi32(e, o));
+		_mm512_storeu_si512(p + 8, _mm512_unpackhi_epi32(e, o));
+	}
+	template<size_t back_step>
+	inline __m512i load_back(i16 const* back)
+	{
+		if constexpr (back_step == 1)
+			return _mm512_permutexvar_epi32(
+				_mm512_setr_epi32(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15),
+				_mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(back))));
+		else return load(reinterpret_cast<pixel const*>(back - 3)).a;
+	}
+	// n / d truncated toward zero, which is exact in double as long as both are far less than 2^52.
+	inline __m512i div(__m512i n, __m512i d)
+	{
+		__m256i const
+			lo = _mm512_cvttpd_epi32(_mm512_div_pd(
+				_mm512_cvtepi32_pd(_mm512_castsi512_si256(n)), _mm512_cvtepi32_pd(_mm512_castsi512_si256(d)))),
+			hi = _mm512_cvttpd_epi32(_mm512_div_pd(
+				_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(n, 1)), _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(d, 1))));
+		return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+	}
+
+	// bits of the comparison masks for the alpha of 8 pixels, one for each.
+	constexpr uint32_t alpha_bits = 0x8888'8888;
+	inline uint64_t above(i16 const* p, __m512i threshold)
+	{
+		return (static_cast<uint64_t>(_mm512_cmpgt_epi16_mask(_mm512_loadu_si512(p), threshold) & alpha_bits)) |
+			(static_cast<uint64_t>(_mm512_cmpgt_epi16_mask(_mm512_loadu_si512(p + 32), threshold) & alpha_bits) << 32);
+	}
+
+	int find_first(i16 const* alpha, int n, i16 threshold)
+	{
+		__m512i const t = _mm512_set1_epi16(threshold);
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			if (uint64_t const hit = above(alpha - 3 + 4 * i, t); hit != 0)
+				return i + std::countr_zero(hit) / 4;
+		}
+		return i + scalar::find_first(alpha + 4 * i, n - i, threshold);
+	}
+
+	int find_last(i16 const* alpha, int n, i16 threshold)
+	{
+		__m512i const t = _mm512_set1_epi16(threshold);
+		int i = n;
+		for (; i >= 16; i -= 16) {
+			if (uint64_t const hit = above(alpha - 3 + 4 * (i - 16), t); hit != 0)
+				return i - 16 + (63 - std::countl_zero(hit)) / 4;
+		}
+		return scalar::find_last(alpha, i, threshold);
+	}
+
+	// 8-bit alpha values `step` bytes apart, where 4 means the last byte of each pixel.
+	template<int step>
+	int find_first8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint64_t bits = step == 1 ? ~uint64_t{ 0 } : 0x8888'8888'8888'8888;
+		constexpr int count = 64 / step;
+		__m512i const t = _mm512_set1_epi8(static_cast<char>(threshold));
+		int i = 0;
+		for (; i + count <= n; i += count) {
+			if (uint64_t const hit = _mm512_cmpgt_epu8_mask(_mm512_loadu_si512(alpha - (step - 1) + step * i), t) & bits; hit != 0)
+				return i + std::countr_zero(hit) / step;
+		}
+		return i + scalar::find_first8<step>(alpha + step * i, n - i, threshold);
+	}
+
+	template<int step>
+	int find_last8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint64_t bits = step == 1 ? ~uint64_t{ 0 } : 0x8888'8888'8888'8888;
+		constexpr int count = 64 / step;
+		__m512i const t = _mm512_set1_epi8(static_cast<char>(threshold));
+		int i = n;
+		for (; i >= count; i -= count) {
+			if (uint64_t const hit = _mm512_cmpgt_epu8_mask(_mm512_loadu_si512(alpha - (step - 1) + step * (i - count)), t) & bits; hit != 0)
+				return i - count + (63 - std::countl_zero(hit)) / step;
+		}
+		return scalar::find_last8<step>(alpha, i, threshold);
+	}
+
+	void fill_alpha(i16* alpha, int n, i16 val)
+	{
+		// masked stores touch only the alpha channels, including the remainder.
+		__m512i const v = _mm512_set1_epi16(val);
+		for (; n >= 8; n -= 8, alpha += 32)
+			_mm512_mask_storeu_epi16(alpha - 3, alpha_bits, v);
+		if (n > 0)
+			_mm512_mask_storeu_epi16(alpha - 3, alpha_bits & ((1u << (4 * n)) - 1), v);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha>
+	void paint(pixel* dst, i16 const* back, pixel const* col, int n, int alpha)
+	{
+		__m512i const v_alpha = _mm512_set1_epi32(alpha), one = _mm512_set1_epi32(1);
+		hextet c{};
+		if constexpr (!pattern)
+			c = { _mm512_set1_epi32(col->y), _mm512_set1_epi32(col->cb), _mm512_set1_epi32(col->cr), _mm512_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 16 <= n; i += 16, dst += 16, back += 16 * back_step) {
+			__m512i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+			if constexpr (pattern) {
+				c = load(col); col += 16;
+				__mmask16 const keep = _mm512_cmpge_epi32_mask(A, one);
+				A = mul_alpha(A, c.a);
+				store(dst, _mm512_maskz_mov_epi32(keep, c.y), _mm512_maskz_mov_epi32(keep, c.cb),
+					_mm512_maskz_mov_epi32(keep, c.cr), _mm512_maskz_mov_epi32(keep, A));
+			}
+			else store(dst, c.y, c.cb, c.cr, A);
+		}
+		scalar::paint<pattern, fixed_alpha>(dst, back, back_step, col, n - i, alpha);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha, int fixed_f_alpha>
+	void blend(pixel* dst, pixel const* src, i16 const* back, pixel const* col, int n, int alpha, int f_alpha)
+	{
+		__m512i const v_alpha = _mm512_set1_epi32(alpha), v_f_alpha = _mm512_set1_epi32(f_alpha),
+			v_max = _mm512_set1_epi32(max_alpha), one = _mm512_set1_epi32(1);
+		hextet c{};
+		if constexpr (!pattern)
+			c = { _mm512_set1_epi32(col->y), _mm512_set1_epi32(col->cb), _mm512_set1_epi32(col->cr), _mm512_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 16 <= n; i += 16, dst += 16, src += 16, back += 16 * back_step) {
+			hextet const s = load(src);
+			__m512i const a = scale<fixed_f_alpha>(v_f_alpha, s.a);
+			__m512i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+
+			// the cases in the order of precedence.
+			__mmask16 const
+				opaque = _mm512_cmpge_epi32_mask(a, v_max),
+				no_back = _mm512_cmplt_epi32_mask(A, one);
+			if constexpr (pattern) {
+				c = load(col); col += 16;
+				A = mul_alpha(A, c.a);
+			}
+			__mmask16 const no_src = _mm512_cmplt_epi32_mask(a, one);
+
+			if constexpr (fixed_alpha == 0) {
+				// nothing behind, so the source only.
+				store(dst, s.y, s.cb, s.cr, select(opaque, s.a, a));
+				continue;
+			}
+			if constexpr (fixed_f_alpha == 0) {
+				// nothing in front, so the color only except where nothing behind either.
+				store(dst, select(no_back, s.y, c.y), select(no_back, s.cb, c.cb), select(no_back, s.cr, c.cr),
+					select(no_back, a, A));
+				continue;
+			}
+
+			__m512i const B = mul_alpha(_mm512_sub_epi32(v_max, a), A), sum = _mm512_add_epi32(a, B);
+			__m512i
+				y  = div(_mm512_add_epi32(_mm512_mullo_epi32(a, s.y ), _mm512_mullo_epi32(B, c.y )), sum),
+				cb = div(_mm512_add_epi32(_mm512_mullo_epi32(a, s.cb), _mm512_mullo_epi32(B, c.cb)), sum),
+				cr = div(_mm512_add_epi32(_mm512_mullo_epi32(a, s.cr), _mm512_mullo_epi32(B, c.cr)), sum),
+				alp = sum;
+
+			y = select(no_src, c.y, y); cb = select(no_src, c.cb, cb); cr = select(no_src, c.cr, cr);
+			alp = select(no_src, A, alp);
+			y = select(no_back, s.y, y); cb = select(no_back, s.cb, cb); cr = select(no_back, s.cr, cr);
+			alp = select(no_back, a, alp);
+			y = select(opaque, s.y, y); cb = select(opaque, s.cb, cb); cr = select(opaque, s.cr, cr);
+			alp = select(opaque, s.a, alp);
+			store(dst, y, cb, cr, alp);
+		}
+		scalar::blend<pattern, fixed_alpha, fixed_f_alpha>(dst, src, back, back_step, col, n - i, alpha, f_alpha);
+	}
+
+	template<bool pattern>
+	void paint_any(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha)
+	{
+		specialize(alpha, [&](auto fa) {
+			constexpr int fixed_alpha = decltype(fa)::value;
+			if (back_step == 1) paint<pattern, 1, fixed_alpha>(dst, back, col, n, alpha);
+			else paint<pattern, 4, fixed_alpha>(dst, back, col, n, alpha);
+		});
+	}
+	template<bool pattern>
+	void blend_any(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+		pixel const* col, int n, int alpha, int f_alpha)
+	{
+		specialize(alpha, [&](auto fa) { specialize(f_alpha, [&](auto ff) {
+			constexpr int fixed_alpha = decltype(fa)::value, fixed_f_alpha = decltype(ff)::value;
+			if (back_step == 1) blend<pattern, 1, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+			else blend<pattern, 4, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+		}); });
+	}
+}
+
+namespace kernels
+{
+	extern table const avx512bw_table = {
+		.find_first = &find_first,
+		.find_last = &find_last,
+		.find_first_a8 = &find_first8<1>,
+		.find_last_a8 = &find_last8<1>,
+		.find_first_rgba8 = &find_first8<4>,
+		.find_last_rgba8 = &find_last8<4>,
+		.fill_alpha = &fill_alpha,
+		.paint_color = &paint_any<false>,
+		.paint_pattern = &paint_any<true>,
+		.blend_color = &blend_any<false>,
+		.blend_pattern = &blend_any<true>,
+	};
+}
@@ -0,0 +1,283 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <bit>
+
+#include <immintrin.h>
+
+#include "kernels.hpp"
+
+using namespace kernels;
+
+
+////////////////////////////////
+// SSE4.1 版．
+////////////////////////////////
+namespace
+{
+	// 4 pixels, each channel in 32-bit lanes.
+	struct quad { __m128i y, cb, cr, a; };
+
+	template<int imm>
+	inline __m128i pick(__m128i p, __m128i q) {
+		return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(p), _mm_castsi128_ps(q), imm));
+	}
+	// as static_cast<i16>, extended back to 32 bits.
+	inline __m128i trunc16(__m128i v) { return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16); }
+	// (a * b) >> log2_max_alpha, truncated to i16.
+	inline __m128i mul_alpha(__m128i a, __m128i b) {
+		return trunc16(_mm_srai_epi32(_mm_mullo_epi32(a, b), log2_max_alpha));
+	}
+	inline __m128i select(__m128i mask, __m128i t, __m128i f) { return _mm_blendv_epi8(f, t, mask); }
+
+	// mul_alpha() by k, where k is `fixed` unless it's `variable`.
+	template<int fixed>
+	inline __m128i scale(__m128i k, __m128i v)
+	{
+		if constexpr (fixed == variable) return mul_alpha(k, v);
+		else if constexpr (fixed == 0) return _mm_setzero_si128();
+		else return v;
+	}
+
+	inline quad load(pixel const* p)
+	{
+		__m128i const
+			p0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p)),
+			p1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 2));
+		// lower and upper halves of each 32 bits, that is, (y, cr) and (cb, a).
+		__m128i const l0 = trunc16(p0), h0 = _mm_srai_epi32(p0, 16),
+			l1 = trunc16(p1), h1 = _mm_srai_epi32(p1, 16);
+		return {
+			pick<_MM_SHUFFLE(2, 0, 2, 0)>(l0, l1), pick<_MM_SHUFFLE(2, 0, 2, 0)>(h0, h1),
+			pick<_MM_SHUFFLE(3, 1, 3, 1)>(l0, l1), pick<_MM_SHUFFLE(3, 1, 3, 1)>(h0, h1),
+		};
+	}
+	inline void store(pixel* p, __m128i y, __m128i cb, __m128i cr, __m128i a)
+	{
+		__m128i const
+			e = _mm_blend_epi16(y, _mm_slli_epi32(cb, 16), 0xaa),
+			o = _mm_blend_epi16(cr, _mm_slli_epi32(a, 16), 0xaa);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_unpacklo_epi32(e, o));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p + 2), _mm_unpackhi_epi32(e, o));
+	}
+	template<size_t back_step>
+	inline __m128i load_back(i16 const* back)
+	{
+		if constexpr (back_step == 1)
+			return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(back)));
+		else return load(reinterpret_cast<pixel const*>(back - 3)).a;
+	}
+	// n / d truncated toward zero, which is exact in double as long as both are far less than 2^52.
+	inline __m128i div(__m128i n, __m128i d)
+	{
+		__m128i const
+			lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(n), _mm_cvtepi32_pd(d))),
+			hi = _mm_cvttpd_epi32(_mm_div_pd(
+				_mm_cvtepi32_pd(_mm_unpackhi_epi64(n, n)), _mm_cvtepi32_pd(_mm_unpackhi_epi64(d, d))));
+		return _mm_unpacklo_epi64(lo, hi);
+	}
+
+	// bits of _mm_movemask_epi8() for the alpha of 4 pixels, one for each.
+	constexpr uint32_t alpha_bits = 0x8080'8080;
+	inline uint32_t above(i16 const* p, __m128i threshold)
+	{
+		return (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi16(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)), threshold))) |
+			(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi16(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 8)), threshold))) << 16)) & alpha_bits;
+	}
+
+	int find_first(i16 const* alpha, int n, i16 threshold)
+	{
+		__m128i const t = _mm_set1_epi16(threshold);
+		int i = 0;
+		for (; i + 4 <= n; i += 4) {
+			if (uint32_t const hit = above(alpha - 3 + 4 * i, t); hit != 0)
+				return i + std::countr_zero(hit) / 8;
+		}
+		return i + scalar::find_first(alpha + 4 * i, n - i, threshold);
+	}
+
+	int find_last(i16 const* alpha, int n, i16 threshold)
+	{
+		__m128i const t = _mm_set1_epi16(threshold);
+		int i = n;
+		for (; i >= 4; i -= 4) {
+			if (uint32_t const hit = above(alpha - 3 + 4 * (i - 4), t); hit != 0)
+				return i - 4 + (31 - std::countl_zero(hit)) / 8;
+		}
+		return scalar::find_last(alpha, i, threshold);
+	}
+
+	// bits of _mm_movemask_epi8() for 32 bytes exceeding `threshold` as unsigned, whose top bit is flipped.
+	inline uint32_t above8(uint8_t const* p, __m128i threshold)
+	{
+		__m128i const flip = _mm_set1_epi8(-128);
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)), flip), threshold))) |
+			(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16)), flip), threshold))) << 16);
+	}
+
+	// 8-bit alpha values `step` bytes apart, where 4 means the last byte of each pixel.
+	template<int step>
+	int find_first8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint32_t bits = step == 1 ? ~uint32_t{ 0 } : 0x8888'8888;
+		constexpr int count = 32 / step;
+		__m128i const t = _mm_set1_epi8(static_cast<char>(threshold ^ 0x80));
+		int i = 0;
+		for (; i + count <= n; i += count) {
+			if (uint32_t const hit = above8(alpha - (step - 1) + step * i, t) & bits; hit != 0)
+				return i + std::countr_zero(hit) / step;
+		}
+		return i + scalar::find_first8<step>(alpha + step * i, n - i, threshold);
+	}
+
+	template<int step>
+	int find_last8(uint8_t const* alpha, int n, uint8_t threshold)
+	{
+		constexpr uint32_t bits = step == 1 ? ~uint32_t{ 0 } : 0x8888'8888;
+		constexpr int count = 32 / step;
+		__m128i const t = _mm_set1_epi8(static_cast<char>(threshold ^ 0x80));
+		int i = n;
+		for (; i >= count; i -= count) {
+			if (uint32_t const hit = above8(alpha - (step - 1) + step * (i - count), t) & bits; hit != 0)
+				return i - count + (31 - std::countl_zero(hit)) / step;
+		}
+		return scalar::find_last8<step>(alpha, i, threshold);
+	}
+
+	void fill_alpha(i16* alpha, int n, i16 val)
+	{
+		__m128i const v = _mm_set1_epi16(val);
+		for (; n >= 2; n -= 2, alpha += 8) {
+			auto* const p = reinterpret_cast<__m128i*>(alpha - 3);
+			_mm_storeu_si128(p, _mm_blend_epi16(_mm_loadu_si128(p), v, 0x88));
+		}
+		scalar::fill_alpha(alpha, n, val);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha>
+	void paint(pixel* dst, i16 const* back, pixel const* col, int n, int alpha)
+	{
+		__m128i const v_alpha = _mm_set1_epi32(alpha), one = _mm_set1_epi32(1);
+		quad c{};
+		if constexpr (!pattern)
+			c = { _mm_set1_epi32(col->y), _mm_set1_epi32(col->cb), _mm_set1_epi32(col->cr), _mm_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 4 <= n; i += 4, dst += 4, back += 4 * back_step) {
+			__m128i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+			if constexpr (pattern) {
+				c = load(col); col += 4;
+				__m128i const clear = _mm_cmpgt_epi32(one, A);
+				A = mul_alpha(A, c.a);
+				store(dst, _mm_andnot_si128(clear, c.y), _mm_andnot_si128(clear, c.cb),
+					_mm_andnot_si128(clear, c.cr), _mm_andnot_si128(clear, A));
+			}
+			else store(dst, c.y, c.cb, c.cr, A);
+		}
+		scalar::paint<pattern, fixed_alpha>(dst, back, back_step, col, n - i, alpha);
+	}
+
+	template<bool pattern, size_t back_step, int fixed_alpha, int fixed_f_alpha>
+	void blend(pixel* dst, pixel const* src, i16 const* back, pixel const* col, int n, int alpha, int f_alpha)
+	{
+		__m128i const v_alpha = _mm_set1_epi32(alpha), v_f_alpha = _mm_set1_epi32(f_alpha),
+			v_max = _mm_set1_epi32(max_alpha), one = _mm_set1_epi32(1);
+		quad c{};
+		if constexpr (!pattern)
+			c = { _mm_set1_epi32(col->y), _mm_set1_epi32(col->cb), _mm_set1_epi32(col->cr), _mm_set1_epi32(col->a) };
+		int i = 0;
+		for (; i + 4 <= n; i += 4, dst += 4, src += 4, back += 4 * back_step) {
+			quad const s = load(src);
+			__m128i const a = scale<fixed_f_alpha>(v_f_alpha, s.a);
+			__m128i A = scale<fixed_alpha>(v_alpha, load_back<back_step>(back));
+
+			// the cases in the order of precedence.
+			__m128i const
+				opaque = _mm_cmpgt_epi32(a, _mm_sub_epi32(v_max, one)),
+				no_back = _mm_cmpgt_epi32(one, A);
+			if constexpr (pattern) {
+				c = load(col); col += 4;
+				A = mul_alpha(A, c.a);
+			}
+			__m128i const no_src = _mm_cmpgt_epi32(one, a);
+
+			if constexpr (fixed_alpha == 0) {
+				// nothing behind, so the source only.
+				store(dst, s.y, s.cb, s.cr, select(opaque, s.a, a));
+				continue;
+			}
+			if constexpr (fixed_f_alpha == 0) {
+				// nothing in front, so the color only except where nothing behind either.
+				store(dst, select(no_back, s.y, c.y), select(no_back, s.cb, c.cb), select(no_back, s.cr, c.cr),
+					select(no_back, a, A));
+				continue;
+			}
+
+			__m128i const B = mul_alpha(_mm_sub_epi32(v_max, a), A), sum = _mm_add_epi32(a, B);
+			__m128i
+				y  = div(_mm_add_epi32(_mm_mullo_epi32(a, s.y ), _mm_mullo_epi32(B, c.y )), sum),
+				cb = div(_mm_add_epi32(_mm_mullo_epi32(a, s.cb), _mm_mullo_epi32(B, c.cb)), sum),
+				cr = div(_mm_add_epi32(_mm_mullo_epi32(a, s.cr), _mm_mullo_epi32(B, c.cr)), sum),
+				alp = sum;
+
+			y = select(no_src, c.y, y); cb = select(no_src, c.cb, cb); cr = select(no_src, c.cr, cr);
+			alp = select(no_src, A, alp);
+			y = select(no_back, s.y, y); cb = select(no_back, s.cb, cb); cr = select(no_back, s.cr, cr);
+			alp = select(no_back, a, alp);
+			y = select(opaque, s.y, y); cb = select(opaque, s.cb, cb); cr = select(opaque, s.cr, cr);
+			alp = select(opaque, s.a, alp);
+			store(dst, y, cb, cr, alp);
+		}
+		scalar::blend<pattern, fixed_alpha, fixed_f_alpha>(dst, src, back, back_step, col, n - i, alpha, f_alpha);
+	}
+
+	template<bool pattern>
+	void paint_any(pixel* dst, i16 const* back, size_t back_step, pixel const* col, int n, int alpha)
+	{
+		specialize(alpha, [&](auto fa) {
+			constexpr int fixed_alpha = decltype(fa)::value;
+			if (back_step == 1) paint<pattern, 1, fixed_alpha>(dst, back, col, n, alpha);
+			else paint<pattern, 4, fixed_alpha>(dst, back, col, n, alpha);
+		});
+	}
+	template<bool pattern>
+	void blend_any(pixel* dst, pixel const* src, i16 const* back, size_t back_step,
+		pixel const* col, int n, int alpha, int f_alpha)
+	{
+		specialize(alpha, [&](auto fa) { specialize(f_alpha, [&](auto ff) {
+			constexpr int fixed_alpha = decltype(fa)::value, fixed_f_alpha = decltype(ff)::value;
+			if (back_step == 1) blend<pattern, 1, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+			else blend<pattern, 4, fixed_alpha, fixed_f_alpha>(dst, src, back, col, n, alpha, f_alpha);
+		}); });
+	}
+}
+
+namespace kernels
+{
+	extern table const sse41_table = {
+		.find_first = &find_first,
+		.find_last = &find_last,
+		.find_first_a8 = &find_first8<1>,
+		.find_last_a8 = &find_last8<1>,
+		.find_first_rgba8 = &find_first8<4>,
+		.find_last_rgba8 = &find_last8<4>,
+		.fill_alpha = &fill_alpha,
+		.paint_color = &paint_any<false>,
+		.paint_pattern = &paint_any<true>,
+		.blend_color = &blend_any<false>,
+		.blend_pattern = &blend_any<true>,
+	};
+}
@@ -13,23 +13,55 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
 #include <tuple>
+#include <utility>
 #include <vector>
+#include <chrono>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 
 ////////////////////////////////
 // AviUtl のマルチスレッド関数のラッパー．
 ////////////////////////////////
+// phases of the work, each of which has its own amount to go parallel.
+enum class work_phase : int32_t {
+	scan,	// pixels to search for the non-transparent ones.
+	graham,	// lines of the shape, both sides together, to find the key points.
+	extend,	// key points to move outward.
+	edges,	// lines of the polygon, both sides together, to draw the edges.
+	fill,	// pixels to fill or to compose.
+	field,	// pixels to evaluate the distance from the outline.
+	count,
+};
+
 inline constinit struct MultiThread {
 	auto operator()(int num_parallel, auto&&... args, auto&& func) const {
 		return (*this)(num_parallel < num_threads(), args..., func);
 	}
+	// runs in parallel only if `work` reaches the cutoff of `phase`.
+	auto operator()(work_phase phase, int work, auto&&... args, auto&& func) const {
+		if (timings == nullptr) return (*this)(work < cutoff(phase), args..., func);
+
+		// the phases nested inside are counted as a part of this one.
+		double* const sums = std::exchange(timings, nullptr);
+		struct timer {
+			double* const sums;
+			double& sum;
+			std::chrono::steady_clock::time_point const t0 = std::chrono::steady_clock::now();
+			~timer() {
+				sum += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+				timings = sums;
+			}
+		} const t{ sums, sums[static_cast<size_t>(phase)] };
+		return (*this)(work < cutoff(phase), args..., func);
+	}
 	auto operator()(bool single_thread, auto&&... args, auto&& func) const
 	{
 		using RetT = std::invoke_result_t<decltype(func), int, int, decltype(args)...>;
-		if (single_thread) {
+		if (single_thread || serial || exec_multi_thread_func == nullptr) {
 			if constexpr (std::is_void_v<RetT>)
 				return func(0, 1, args...);
 			else return std::vector<RetT>{ func(0, 1, args...) };
@@ -60,16 +92,41 @@ inline constinit struct MultiThread {
 		}
 	}
 
+	// the least amount of work in each phase that pays for dispatching to the threads.
+	// the defaults are rough guesses, replaced by the measurement on the machine (see calibration.hpp).
+	int32_t cutoffs[static_cast<size_t>(work_phase::count)] = { 1 << 14, 1 << 6, 1 << 6, 1 << 6, 1 << 14, 1 << 12 };
+	int32_t cutoff(work_phase phase) const { return cutoffs[static_cast<size_t>(phase)]; }
+
 	int32_t num_threads() const {
+		if (ptr_num_threads == nullptr) return 1; // not initialized yet.
 		return *ptr_num_threads != 0 ? *ptr_num_threads : def_num_threads;
 	}
 
+	// set on the threads that each process a whole frame, so the work inside stays on that thread.
+	static inline thread_local bool serial = false;
+
+	// if set, the seconds spent in each phase started from this thread are added to it,
+	// an array of work_phase::count elements, for profiling.
+	static inline thread_local double* timings = nullptr;
+
+	// runs the work on std::thread, outside AviUtl such as in the command-line tool.
+	// `num_threads` of 0 means as many as the hardware supports.
+	void init_standalone(int32_t num_threads) {
+		if (def_num_threads > 0) return;
+
+		def_num_threads = num_threads > 0 ? num_threads : std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+		ptr_num_threads = &def_num_threads;
+		exec_multi_thread_func = &exec_standalone;
+	}
+
 private:
 	//decltype(AviUtl::ExFunc::exec_multi_thread_func) exec_multi_thread_func = nullptr;
 	int32_t (*exec_multi_thread_func)(void(*func)(int thread_id, int thread_num, void* param1, void* param2), void* param1, void* param2) = nullptr;
 	int32_t* ptr_num_threads = nullptr; // 0x086384
 	int32_t def_num_threads = 0;
 
+	static int32_t exec_standalone(void(*func)(int thread_id, int thread_num, void* param1, void* param2), void* param1, void* param2);
+
 	friend struct ExEdit092;
 	void init(decltype(exec_multi_thread_func) mt_func, int32_t* num_threads) {
 		if (def_num_threads > 0) return;
@@ -80,3 +137,58 @@ private:
 	}
 } multi_thread{};
 
+inline int32_t MultiThread::exec_standalone(void(*func)(int thread_id, int thread_num, void* param1, void* param2), void* param1, void* param2)
+{
+	// the threads are kept for later calls, and take the work each time the generation advances.
+	// the work inside runs on the same thread, as all of them are busy.
+	static struct pool {
+		std::mutex dispatching, mtx;
+		std::condition_variable_any wake;
+		std::condition_variable done;
+		std::vector<std::jthread> threads{};
+		uint64_t generation = 0;
+		int running = 0;
+		struct {
+			void(*func)(int thread_id, int thread_num, void* param1, void* param2);
+			void* param1, * param2; int thread_num;
+		} work{};
+
+		void run(std::stop_token stop, int thread_id) {
+			serial = true;
+			for (uint64_t seen = 0;;) {
+				std::unique_lock lock{ mtx };
+				if (!wake.wait(lock, stop, [&] { return generation != seen; })) return;
+				seen = generation;
+				auto const w = work;
+				if (thread_id >= w.thread_num) continue;
+				lock.unlock();
+
+				w.func(thread_id, w.thread_num, w.param1, w.param2);
+
+				lock.lock();
+				if (--running == 0) done.notify_one();
+			}
+		}
+	} pool{};
+
+	int const n = multi_thread.num_threads();
+	std::lock_guard dispatching{ pool.dispatching };
+	{
+		std::lock_guard lock{ pool.mtx };
+		for (int i = static_cast<int>(pool.threads.size()) + 1; i < n; i++)
+			pool.threads.emplace_back([i](std::stop_token stop) { pool.run(stop, i); });
+		pool.work = { func, param1, param2, n };
+		pool.running = n - 1;
+		pool.generation++;
+	}
+	pool.wake.notify_all();
+
+	bool const was_serial = std::exchange(serial, true);
+	func(0, n, param1, param2);
+	serial = was_serial;
+
+	std::unique_lock lock{ pool.mtx };
+	pool.done.wait(lock, [&] { return pool.running == 0; });
+	return 1;
+}
+
@@ -0,0 +1,695 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <numbers>
+#include <optional>
+#include <vector>
+
+#include "multi_thread.hpp"
+#include "convex_closure.hpp"
+#include "distance_field.hpp"
+#include "concave.hpp"
+#include "enclosing.hpp"
+#include "clusters.hpp"
+#include "kernels.hpp"
+#include "hull_cache.hpp"
+#include "render.hpp"
+
+using namespace render;
+using convex_closure::write_mode;
+
+
+////////////////////////////////
+// フィルタ効果の本体．
+////////////////////////////////
+// scratch buffers, kept for reuse.
+static thread_local std::vector<int> heap_buf{};
+static thread_local std::vector<i16> coverage_buf{};
+static thread_local convex_closure::concave concave_buf{};
+static thread_local convex_closure::enclosing enclosing_buf{};
+static thread_local std::vector<pixel> gradient_buf{};
+static thread_local convex_closure::clusters parts_buf{};
+static thread_local std::vector<int> parts_heap_buf{};
+static thread_local std::vector<i16> parts_keep_buf{};
+
+// a cluster drawn separately, taken as an object as large as its bounding box.
+struct cluster_part {
+	convex_closure::box b; // in src, which is also where its top-left corner is in dst.
+	int dst_w, dst_h; // the size including the margin.
+	convex_closure::hull outer, inner;
+	std::optional<convex_closure::outline> ol;
+	convex_closure::box drawn;
+};
+static thread_local std::vector<cluster_part> pieces_buf{};
+
+// finds the key points of the shape, or reuses those found before for the same alpha plane.
+static bool find_hull(convex_closure::hull& hull, convex_closure::hull const* found,
+	pixel const* src, int src_w, int src_h, size_t src_line, i16 threshold, bool draft)
+{
+	if (found != nullptr) {
+		found->copy_to(hull);
+		return true;
+	}
+	if (!hull_cache::enabled())
+		return convex_closure::find_key_points<4>(hull, &src->a, src_w, src_h, 4 * src_line, threshold, draft);
+
+	auto const key = hull_cache::make_key(&src->a, src_w, src_h, 4 * src_line, threshold, draft);
+	if (hull_cache::load(key, &src->a, 4 * src_line, hull)) return true;
+	if (!convex_closure::find_key_points<4>(hull, &src->a, src_w, src_h, 4 * src_line, threshold, draft))
+		return false;
+	hull_cache::store(key, hull);
+	return true;
+}
+
+void render::compose(params const& p, pixel const* src, int src_w, int src_h, size_t src_line, pixel* dst, size_t dst_line,
+	convex_closure::hull const* found)
+{
+	// the distance field is drawn as the feather as wide as its range, without the outline or the original image.
+	bool const field = p.field > 0;
+	int const
+		extend = p.extend, stroke = field ? 0 : p.stroke, feather = field ? 2 * p.field : p.feather, gap = p.gap,
+		alpha = p.alpha, f_alpha = field ? 0 : p.f_alpha,
+		margin = p.margin(), dst_w = src_w + 2 * margin, dst_h = src_h + 2 * margin;
+	i16 const threshold = p.threshold;
+	auto const kind = static_cast<convex_closure::enclosing_kind>(std::clamp(p.shape, 0, 3));
+	bool const draft = p.draft, antialias = p.antialias, enclose = kind != convex_closure::enclosing_kind::hull,
+		concave = p.concave > 0 && !enclose, separate = p.separate && !concave && !enclose,
+		// rounded corners make a difference only when the polygon is moved outward.
+		round = p.round && margin > 0;
+
+	// find the shape, or the clusters of it, and handle trivial cases.
+	// the hull is kept in the buffer of this thread, apart from the pattern image,
+	// as it's referred to until the last line is composed.
+	auto& heap = heap_buf;
+	heap.resize(std::max(heap.size(), 2 * convex_closure::hull::heap_size(dst_h) / sizeof(int)));
+	convex_closure::hull hull{ heap.data(), dst_h };
+	auto& parts = parts_buf;
+	auto& shape = concave_buf;
+	if (alpha <= 0 || (concave ?
+		!shape.build<4>(&src->a, src_w, src_h, 4 * src_line, threshold, margin, extend, round, p.concave) :
+		separate ?
+		parts.scan<4>(&src->a, src_w, src_h, 4 * src_line, threshold, gap) == 0 :
+		!find_hull(hull, found, src, src_w, src_h, src_line, threshold, draft))) {
+		if (margin > 0) {
+			auto do_work = [&]<bool handle_alpha>{
+				multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+					for (int y = thread_id; y < dst_h; y += thread_num) {
+						auto* dst_y = &dst[y * dst_line];
+						if (y < margin || y >= dst_h - margin) {
+							for (int x = dst_w; --x >= 0; dst_y++) dst_y->a = 0;
+						}
+						else {
+							for (int x = margin; --x >= 0; dst_y++) dst_y->a = 0;
+							auto const* src_y = &src[(y - margin) * src_line];
+							if constexpr (handle_alpha) {
+								for (int x = src_w; --x >= 0; dst_y++, src_y++) {
+									*dst_y = *src_y;
+									dst_y->a = (f_alpha * dst_y->a) >> log2_max_alpha;
+								}
+							}
+							else {
+								std::memcpy(dst_y, src_y, sizeof(*dst_y) * src_w);
+								dst_y += src_w;
+							}
+							for (int x = margin; --x >= 0; dst_y++) dst_y->a = 0;
+						}
+					}
+				});
+			};
+			if (f_alpha < max_alpha) do_work.operator()<true>(); else do_work.operator()<false>();
+		}
+		else if (f_alpha < max_alpha) {
+			multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+				int y0 = dst_h * thread_id / thread_num, y1 = dst_h * (thread_id + 1) / thread_num;
+				i16* dst_y = &dst[y0 * dst_line].a;
+				for (int y = y1 - y0; --y >= 0; dst_y += 4 * dst_line) {
+					i16* dst_x = dst_y;
+					for (int x = dst_w; --x >= 0; dst_x += 4)
+						*dst_x = (f_alpha * (*dst_x)) >> log2_max_alpha;
+				}
+			});
+		}
+		return;
+	}
+
+	// trade the exactness for fewer vertices if specified.
+	if (!separate && !concave && !enclose) convex_closure::simplify_key_points(hull, p.simplify);
+	auto& pieces = pieces_buf;
+	pieces.clear();
+
+	// draw the convex closure into the alpha channel of dst,
+	// or into a plane of its own when the result is composed in place, without margin.
+	bool const in_place = margin == 0;
+	auto& coverage = coverage_buf;
+	if (in_place) coverage.resize(std::max(coverage.size(), static_cast<size_t>(dst_w) * dst_h));
+	i16* const cov_a = in_place ? coverage.data() : &dst->a;
+	size_t const cov_step = in_place ? 1 : 4, cov_stride = in_place ? dst_w : 4 * dst_line;
+
+	// bounding box of what's drawn, in the coordinates of dst.
+	convex_closure::box drawn{ dst_w, dst_h, 0, 0 };
+	auto const add_box = [&](convex_closure::hull const& h, int expand) {
+		auto const b = convex_closure::bounding_box(h);
+		drawn.left = std::min(drawn.left, b.left + margin - expand);
+		drawn.top = std::min(drawn.top, b.top + margin - expand);
+		drawn.right = std::max(drawn.right, b.right + margin + expand);
+		drawn.bottom = std::max(drawn.bottom, b.bottom + margin + expand);
+	};
+
+	// the edge fades out linearly across the width of `feather`, centered at the boundary.
+	// without feather, rounded corners are drawn by the same field, antialiased across a pixel.
+	float const half = std::max(0.5f * feather, 0.5f), inv = static_cast<float>(max_alpha) / std::max(feather, 1);
+	auto const ramp = [&](float d) {
+		return std::clamp(static_cast<int>(std::lround(0.5f * max_alpha - d * inv)), 0, max_alpha);
+	};
+	// with rounded corners, the distance is measured from the convex closure itself,
+	// and the boundary is at `extend` from it, where the outward edges meet the arcs around the vertices.
+	int const base = round ? 0 : extend;
+	float const d_base = static_cast<float>(extend - base), d_in = d_base - half, d_out = d_base + stroke + half;
+	auto const fade = [&](float d) {
+		d -= d_base;
+		int const A = stroke > 0 ? std::min(ramp(d - stroke), max_alpha - ramp(d)) : ramp(d);
+		// without antialiasing, only the pixels entirely covered are drawn.
+		return static_cast<i16>(feather <= 0 && !antialias && A < max_alpha ? 0 : A);
+	};
+	auto const outline_of = [&](convex_closure::hull& h) -> convex_closure::outline {
+		convex_closure::extend_key_points<true>(h, src_w, src_h, base);
+		add_box(h, extend - base + stroke + (feather + 1) / 2);
+		return { h, h.LT.x_map };
+	};
+
+	// draws what can be drawn in advance, and passes `then` the function that
+	// fills the alpha of the line y, deferred until the line is composed,
+	// along with the one that tells the span of the line left to src alone, [0, 0) if none.
+	constexpr auto no_hole = [](int) { return std::pair{ 0, 0 }; };
+	auto const draw = [&]<size_t dst_step>(i16* dst_a, size_t dst_stride, auto&& then) {
+		// only the edges of the polygon, leaving the rest to convex_closure::rasterize_line().
+		auto const draw_edges = [&]<write_mode mode>(convex_closure::hull& h, int ext) {
+			convex_closure::extend_key_points<true>(h, src_w, src_h, ext);
+			if constexpr (mode != write_mode::subtract) add_box(h, 0);
+			(antialias ? convex_closure::rasterize_edges<dst_step, true, mode> : convex_closure::rasterize_edges<dst_step, false, mode>)
+				(h, dst_a, dst_stride, margin);
+		};
+
+		if (enclose) {
+			// fitted to the polygon before extension, and moved outward by `base` as the polygon would be.
+			auto& plate = enclosing_buf;
+			plate.fit(hull, kind, margin, static_cast<float>(base));
+			drawn = plate.bounds(d_base + stroke + (feather + 1) / 2);
+			return then(convex_closure::enclosing_rasterizer<dst_step>(plate, dst_a, dst_w, dst_stride, d_in, d_out, fade), no_hole);
+		}
+		else if (concave) {
+			// moved outward already, so measured from the boundary itself.
+			auto const& b = shape.bounds;
+			int const expand = stroke + (feather + 1) / 2;
+			drawn = { b.left - expand, b.top - expand, b.right + expand, b.bottom + expand };
+			return then(convex_closure::concave_rasterizer<dst_step>(shape, dst_a, dst_w, dst_stride,
+				d_in - d_base, d_out - d_base, [&](float d) { return fade(d + d_base); }), no_hole);
+		}
+		else if (separate) {
+			// each cluster is taken as an object as large as its bounding box, with a heap of its own,
+			// and the threads find and extend the hulls in turn. the edges are drawn afterward, one cluster after another,
+			// into the alpha, and the spans between them are filled line by line.
+			bool const by_field = feather > 0 || round, hollow = !by_field && stroke > 0;
+			int const n = parts.size(), copies = hollow ? 2 : 1;
+			size_t heap_total = 0;
+			for (int i = 0; i < n; i++) {
+				auto const b = parts.bounds(i);
+				heap_total += copies * convex_closure::hull::heap_size(b.bottom - b.top + 2 * margin) / sizeof(int);
+			}
+			auto& heap_p = parts_heap_buf;
+			heap_p.resize(std::max(heap_p.size(), heap_total));
+			pieces.reserve(n);
+			int* hp = heap_p.data();
+			for (int i = 0; i < n; i++) {
+				auto const b = parts.bounds(i);
+				int const w = b.right - b.left + 2 * margin, h = b.bottom - b.top + 2 * margin;
+				size_t const hs = convex_closure::hull::heap_size(h) / sizeof(int);
+				pieces.push_back({ b, w, h, { hp, h }, { hp + (copies - 1) * hs, h } });
+				hp += copies * hs;
+			}
+
+			std::atomic<int> next = 0;
+			multi_thread(n < 2, [&](int thread_id, int thread_num) {
+				// the work on each cluster stays on its thread.
+				bool const was_serial = std::exchange(MultiThread::serial, MultiThread::serial || thread_num > 1);
+				for (int i; (i = next++) < n;) {
+					auto& pt = pieces[i];
+					int const w = pt.b.right - pt.b.left, h = pt.b.bottom - pt.b.top;
+					parts.find_key_points(pt.outer, i, pt.b);
+					convex_closure::simplify_key_points(pt.outer, p.simplify);
+
+					int expand = 0;
+					if (by_field) {
+						convex_closure::extend_key_points<true>(pt.outer, w, h, base);
+						pt.ol.emplace(pt.outer, pt.outer.LT.x_map);
+						expand = extend - base + stroke + (feather + 1) / 2;
+					}
+					else {
+						if (hollow) {
+							// keep the original polygon for the inner side of the outline.
+							pt.outer.copy_to(pt.inner);
+							convex_closure::extend_key_points<true>(pt.inner, w, h, extend);
+						}
+						convex_closure::extend_key_points<true>(pt.outer, w, h, margin);
+					}
+					auto const bb = convex_closure::bounding_box(pt.outer);
+					int const ox = pt.b.left + margin, oy = pt.b.top + margin;
+					pt.drawn = { bb.left + ox - expand, bb.top + oy - expand, bb.right + ox + expand, bb.bottom + oy + expand };
+				}
+				MultiThread::serial = was_serial;
+			});
+			for (auto const& pt : pieces) {
+				drawn.left = std::min(drawn.left, pt.drawn.left);
+				drawn.top = std::min(drawn.top, pt.drawn.top);
+				drawn.right = std::max(drawn.right, pt.drawn.right);
+				drawn.bottom = std::max(drawn.bottom, pt.drawn.bottom);
+			}
+
+			// the edges are combined into the alpha cleared beforehand, while the inner ones are subtracted
+			// from a plane of the opaque, which is taken away from the alpha after the spans are filled.
+			i16* keep = nullptr;
+			if (!by_field) {
+				auto& keep_p = parts_keep_buf;
+				if (hollow) {
+					keep_p.resize(std::max(keep_p.size(), static_cast<size_t>(dst_w) * dst_h));
+					keep = keep_p.data();
+				}
+				multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+					for (int y = thread_id; y < dst_h; y += thread_num) {
+						convex_closure::fill_span<dst_step>(dst_a + y * dst_stride, dst_w, 0);
+						if (hollow) std::fill_n(keep + y * dst_w, dst_w, max_alpha);
+					}
+				});
+				auto const edges = [&]<size_t step, write_mode mode>(convex_closure::hull const& h, i16* dst, size_t stride) {
+					(antialias ? convex_closure::rasterize_edges<step, true, mode> : convex_closure::rasterize_edges<step, false, mode>)
+						(h, dst, stride, margin);
+				};
+				for (auto const& pt : pieces) {
+					edges.template operator()<dst_step, write_mode::combine>(pt.outer,
+						dst_a + pt.b.top * dst_stride + pt.b.left * dst_step, dst_stride);
+					if (hollow) edges.template operator()<1, write_mode::subtract>(pt.inner,
+						keep + pt.b.top * dst_w + pt.b.left, dst_w);
+				}
+			}
+
+			return then([=, &pieces](int y) {
+				i16* const dst_y = dst_a + y * dst_stride;
+
+				// the clusters that cross this line, which are sorted by their tops.
+				auto const for_line = [&](auto&& f) {
+					for (auto const& pt : pieces) {
+						if (pt.b.top > y) break;
+						if (int const ly = y - pt.b.top; ly < pt.dst_h) f(pt, ly, dst_y + pt.b.left * dst_step);
+					}
+				};
+				if (by_field) {
+					convex_closure::fill_span<dst_step>(dst_y, dst_w, 0);
+					for_line([&](cluster_part const& pt, int ly, i16*) {
+						convex_closure::field_rasterizer<dst_step, write_mode::combine>(*pt.ol,
+							dst_a + pt.b.top * dst_stride + pt.b.left * dst_step, pt.dst_w, dst_stride,
+							margin, d_in, d_out, fade)(ly);
+					});
+					return;
+				}
+
+				// the span between the edges drawn beforehand, as convex_closure::rasterize_line() does.
+				auto const span = [&](convex_closure::hull const& h, int ly, i16* dst, i16 val) {
+					if (ly < h.LT.top + margin || ly > h.RB.btm + margin) return;
+					int const l = h.LT.x_map[2 * ly + 1], r = h.RB.x_map[2 * ly];
+					convex_closure::fill_span<dst_step>(dst + l * dst_step, r - l, val);
+				};
+				for_line([&](cluster_part const& pt, int ly, i16* dst) { span(pt.outer, ly, dst, max_alpha); });
+
+				// hollow out all of them after drawing, taking away the inner edges wherever they are.
+				if (hollow) {
+					int lo = dst_w, hi = 0;
+					for_line([&](cluster_part const& pt, int ly, i16*) {
+						if (ly < pt.inner.LT.top + margin || ly > pt.inner.RB.btm + margin) return;
+						lo = std::min(lo, pt.b.left + pt.inner.LT.x_map[2 * ly]);
+						hi = std::max(hi, pt.b.left + pt.inner.RB.x_map[2 * ly + 1]);
+					});
+					i16 const* const keep_y = keep + y * dst_w;
+					for (int x = lo; x < hi; x++) {
+						i16& d = dst_y[x * dst_step];
+						d = static_cast<i16>(std::max(d + keep_y[x] - max_alpha, 0));
+					}
+					for_line([&](cluster_part const& pt, int ly, i16* dst) { span(pt.inner, ly, dst, 0); });
+				}
+			}, no_hole);
+		}
+		else if (feather > 0 || round)
+			return then(convex_closure::field_rasterizer<dst_step>(outline_of(hull), dst_a,
+				dst_w, dst_stride, margin, d_in, d_out, fade), no_hole);
+		else if (stroke > 0) {
+			// only the ring between the polygon and the inner one, the original polygon extended by `extend`,
+			// is drawn, and the inside of the inner one is left to src alone.
+			convex_closure::hull inner{ heap.data() + convex_closure::hull::heap_size(dst_h) / sizeof(int), dst_h };
+			hull.copy_to(inner);
+			convex_closure::extend_key_points<true>(inner, src_w, src_h, extend);
+			auto const inner_edges = [&]<write_mode mode>() {
+				(antialias ? convex_closure::rasterize_edges<dst_step, true, mode> : convex_closure::rasterize_edges<dst_step, false, mode>)
+					(inner, dst_a, dst_stride, margin);
+			};
+
+			// the inner edges are drawn first for their x_map, and overwritten where the outer ones meet them.
+			inner_edges.template operator()<write_mode::overwrite>();
+			draw_edges.template operator()<write_mode::overwrite>(hull, margin);
+
+			// then fill the inner edges opaque where the outer ones aren't, and subtract them.
+			int const top = inner.LT.top + margin, btm = inner.RB.btm + margin;
+			multi_thread(work_phase::edges, 2 * (btm + 1 - top), [&](int thread_id, int thread_num) {
+				for (int y = top + thread_id; y <= btm; y += thread_num) {
+					i16* const dst_y = dst_a + y * dst_stride;
+					int const x2 = hull.LT.x_map[2 * y + 1], x3 = hull.RB.x_map[2 * y];
+					for (auto const* e : { inner.LT.x_map + 2 * y, inner.RB.x_map + 2 * y }) {
+						int const l = std::max(e[0], x2), r = std::min(e[1], x3);
+						convex_closure::fill_span<dst_step>(dst_y + l * dst_step, r - l, max_alpha);
+					}
+				}
+			});
+			inner_edges.template operator()<write_mode::subtract>();
+
+			// the inside of the inner polygon that src covers.
+			auto const hole = [=](int y) {
+				if (y < std::max(top, margin) || y > std::min(btm, dst_h - margin - 1)) return std::pair{ 0, 0 };
+				int const l = std::max(inner.LT.x_map[2 * y + 1], margin), r = std::min(inner.RB.x_map[2 * y], margin + src_w);
+				return l < r ? std::pair{ l, r } : std::pair{ 0, 0 };
+			};
+			return then([=, &hull](int y) {
+				if (y < top || y > btm) {
+					convex_closure::rasterize_line<dst_step>(hull, dst_a, dst_w, dst_stride, margin, y);
+					return;
+				}
+				i16* const dst_y = dst_a + y * dst_stride;
+				auto const ol = hull.LT.x_map + 2 * y, or_ = hull.RB.x_map + 2 * y,
+					il = inner.LT.x_map + 2 * y, ir = inner.RB.x_map + 2 * y;
+				auto const fill = [&](int x0, int x1, i16 val) {
+					convex_closure::fill_span<dst_step>(dst_y + x0 * dst_step, x1 - x0, val);
+				};
+				fill(0, ol[0], 0);
+				fill(ol[1], il[0], max_alpha);
+				fill(ir[1], or_[0], max_alpha);
+				fill(or_[1], dst_w, 0);
+
+				// the inside is cleared only where it's composed with the color.
+				auto const [h0, h1] = hole(y);
+				if (h0 < h1) {
+					fill(il[1], h0, 0);
+					fill(h1, ir[0], 0);
+				}
+				else fill(il[1], ir[0], 0);
+			}, hole);
+		}
+		else {
+			draw_edges.template operator()<write_mode::overwrite>(hull, margin);
+			return then([=, &hull](int y) {
+				convex_closure::rasterize_line<dst_step>(hull, dst_a, dst_w, dst_stride, margin, y);
+			}, no_hole);
+		}
+	};
+	// composes the lines, each filled by `fill_line(y)` just before, taken as is without type erasure
+	// so nothing is allocated for it.
+	auto const compose_lines = [&](auto&& fill_line, auto&& hole_of) {
+		// fill and compose the lines in horizontal bands, each of which fits in the L2 cache,
+		// so the pixels are still hot when composed.
+		constexpr size_t band_bytes = 1 << 18;
+		int const band_h = std::max(static_cast<int>(band_bytes / (2 * sizeof(pixel) * dst_w)), 1),
+			num_bands = (dst_h + band_h - 1) / band_h;
+		auto const run_bands = [&](auto&& compose_line) {
+			multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+				for (int b = thread_id; b < num_bands; b += thread_num) {
+					int const y0 = b * band_h, y1 = std::min(y0 + band_h, dst_h);
+					for (int y = y0; y < y1; y++) fill_line(y);
+					for (int y = y0; y < y1; y++) compose_line(y);
+				}
+			});
+		};
+
+		// applies `blend(x0, x1)` on the pixels of the line y that src covers, except the hole,
+		// where src is copied as is, or even left untouched when dst is src itself.
+		bool const keep_src = margin == 0 && dst == src && dst_line == src_line && f_alpha >= max_alpha;
+		auto const around_hole = [&](int y, auto&& blend) {
+			auto const [h0, h1] = hole_of(y);
+			if (h0 >= h1) {
+				blend(margin, margin + src_w);
+				return;
+			}
+			blend(margin, h0);
+			if (!keep_src) {
+				auto* dst_x = &dst[y * dst_line + h0];
+				auto const* src_x = &src[(y - margin) * src_line + (h0 - margin)];
+				if (f_alpha >= max_alpha) std::memmove(dst_x, src_x, sizeof(*dst_x) * (h1 - h0));
+				else {
+					for (int x = h1 - h0; --x >= 0; dst_x++, src_x++) {
+						*dst_x = *src_x;
+						dst_x->a = (f_alpha * dst_x->a) >> log2_max_alpha;
+					}
+				}
+			}
+			blend(h1, margin + src_w);
+		};
+
+		// compose into dst, which may be src itself, where src_y and dst_y point to the same pixel.
+		if (p.img != nullptr) {
+			auto const& img = *p.img;
+			run_bands([&](int y) {
+				auto* const dst_y = &dst[y * dst_line];
+				i16 const* const back = cov_a + y * cov_stride;
+				auto const* const pat_y = &img.buff[(y + img.oy) % img.h * img.line];
+
+				// applies `kernel` on [x0, x1), split where the pattern wraps around.
+				auto const tile = [&](int x0, int x1, auto&& kernel) {
+					for (int x = x0, i_x = (x0 + img.ox) % img.w; x < x1; i_x = 0) {
+						int const n = std::min(x1 - x, img.w - i_x);
+						kernel(x, pat_y + i_x, n);
+						x += n;
+					}
+				};
+				auto const paint = [&](int x0, int x1) {
+					tile(x0, x1, [&](int x, pixel const* col, int n) {
+						kernels::active.paint_pattern(dst_y + x, back + x * cov_step, cov_step, col, n, alpha);
+					});
+				};
+				if (y < margin || y >= dst_h - margin) paint(0, dst_w);
+				else {
+					paint(0, margin);
+
+					auto const* const src_y = &src[(y - margin) * src_line];
+					around_hole(y, [&](int x0, int x1) {
+						tile(x0, x1, [&](int x, pixel const* col, int n) {
+							kernels::active.blend_pattern(dst_y + x, src_y + (x - margin),
+								back + x * cov_step, cov_step, col, n, alpha, f_alpha);
+						});
+					});
+
+					paint(margin + src_w, dst_w);
+				}
+			});
+		}
+		else {
+			auto const& col = p.col;
+			int const grad = std::clamp(p.gradient, 0, 4);
+			if (grad == 0) {
+				// a single color, by the vectorized kernels.
+				pixel const c{ .y = col.y, .cb = col.cb, .cr = col.cr, .a = max_alpha };
+				run_bands([&](int y) {
+					auto* const dst_y = &dst[y * dst_line];
+					i16 const* const back = cov_a + y * cov_stride;
+					auto const paint = [&](int x0, int x1) {
+						kernels::active.paint_color(dst_y + x0, back + x0 * cov_step, cov_step, &c, x1 - x0, alpha);
+					};
+					if (y < margin || y >= dst_h - margin) paint(0, dst_w);
+					else {
+						paint(0, margin);
+						auto const* const src_y = &src[(y - margin) * src_line];
+						around_hole(y, [&](int x0, int x1) {
+							kernels::active.blend_color(dst_y + x0, src_y + (x0 - margin),
+								back + x0 * cov_step, cov_step, &c, x1 - x0, alpha, f_alpha);
+						});
+						paint(margin + src_w, dst_w);
+					}
+				});
+			}
+			else {
+				// gradient from `col` to `col2`, across the entire object or the convex closure.
+				auto const& col2 = p.col2;
+				auto const b = grad <= 2 ? convex_closure::box{ 0, 0, dst_w, dst_h } : drawn;
+				float const
+					w = static_cast<float>(b.right - b.left), h = static_cast<float>(b.bottom - b.top),
+					cx = 0.5f * (b.left + b.right) - 0.5f, cy = 0.5f * (b.top + b.bottom) - 0.5f;
+				auto const mix = [&](float t) -> pixel {
+					t = std::clamp(t, 0.0f, 1.0f);
+					return {
+						static_cast<i16>(col.y  + std::lround(t * (col2.y  - col.y ))),
+						static_cast<i16>(col.cb + std::lround(t * (col2.cb - col.cb))),
+						static_cast<i16>(col.cr + std::lround(t * (col2.cr - col.cr))),
+						max_alpha,
+					};
+				};
+				// the colors of the line, filled into a row and composed as a pattern.
+				auto const do_work = [&](auto&& fill_row) {
+					run_bands([&](int y) {
+						auto& row = gradient_buf;
+						row.resize(std::max<size_t>(row.size(), dst_w));
+						fill_row(row.data(), y);
+
+						auto* const dst_y = &dst[y * dst_line];
+						i16 const* const back = cov_a + y * cov_stride;
+						auto const paint = [&](int x0, int x1) {
+							kernels::active.paint_pattern(dst_y + x0, back + x0 * cov_step, cov_step, row.data() + x0, x1 - x0, alpha);
+						};
+						if (y < margin || y >= dst_h - margin) paint(0, dst_w);
+						else {
+							paint(0, margin);
+							auto const* const src_y = &src[(y - margin) * src_line];
+							around_hole(y, [&](int x0, int x1) {
+								kernels::active.blend_pattern(dst_y + x0, src_y + (x0 - margin),
+									back + x0 * cov_step, cov_step, row.data() + x0, x1 - x0, alpha, f_alpha);
+							});
+							paint(margin + src_w, dst_w);
+						}
+					});
+				};
+				if (grad % 2 != 0) {
+					// linear, changing at a constant rate along the direction of `angle`,
+					// and spanning the box from one end to the other.
+					float const rad = p.angle * (std::numbers::pi_v<float> / 180),
+						c = std::cos(rad), s = std::sin(rad), len = std::max(std::abs(w * c) + std::abs(h * s), 1.0f),
+						dx = c / len, dy = s / len;
+					do_work([&](pixel* row, int y) {
+						float t = 0.5f - cx * dx + (y - cy) * dy;
+						for (int x = 0; x < dst_w; x++, t += dx) row[x] = mix(t);
+					});
+				}
+				else {
+					// radial, reaching the corners of the box.
+					float const inv_r = 2 / std::max(std::sqrt(w * w + h * h), 1.0f);
+					do_work([&](pixel* row, int y) {
+						float const dy2 = (y - cy) * (y - cy);
+						for (int x = 0; x < dst_w; x++) row[x] = mix(std::sqrt((x - cx) * (x - cx) + dy2) * inv_r);
+					});
+				}
+			}
+		}
+	};
+	if (in_place) draw.operator()<1>(cov_a, cov_stride, compose_lines);
+	else draw.operator()<4>(cov_a, cov_stride, compose_lines);
+}
+
+bool render::distance(params const& p, pixel const* src, int src_w, int src_h, size_t src_line, i16* plane, size_t plane_line)
+{
+	int const range = p.field, extend = p.extend, margin = p.margin(),
+		dst_w = src_w + 2 * margin, dst_h = src_h + 2 * margin;
+	if (range <= 0) return false;
+
+	auto& heap = heap_buf;
+	heap.resize(std::max(heap.size(), 2 * convex_closure::hull::heap_size(dst_h) / sizeof(int)));
+	convex_closure::hull hull{ heap.data(), dst_h };
+	auto& parts = parts_buf;
+	auto const kind = static_cast<convex_closure::enclosing_kind>(std::clamp(p.shape, 0, 3));
+	if (kind == convex_closure::enclosing_kind::hull && p.concave > 0) {
+		auto& shape = concave_buf;
+		if (!shape.build<4>(&src->a, src_w, src_h, 4 * src_line, p.threshold, margin, extend, p.round, p.concave))
+			return false;
+		auto const line = convex_closure::concave_rasterizer<1>(shape, plane, dst_w, plane_line,
+			static_cast<float>(-range), static_cast<float>(range),
+			[](float d) { return static_cast<i16>(std::lround(d * distance_unit)); });
+		multi_thread(work_phase::field, dst_w * dst_h, [&](int thread_id, int thread_num) {
+			for (int y = thread_id; y < dst_h; y += thread_num) line(y);
+		});
+		return true;
+	}
+	bool const separate = p.separate && kind == convex_closure::enclosing_kind::hull;
+	if (separate ?
+		parts.scan<4>(&src->a, src_w, src_h, 4 * src_line, p.threshold, p.gap) == 0 :
+		!find_hull(hull, nullptr, src, src_w, src_h, src_line, p.threshold, p.draft)) return false;
+
+	// measured from the convex closure itself for rounded corners, as compose() does.
+	int const base = p.round ? 0 : extend;
+	float const d_base = static_cast<float>(extend - base), d_in = d_base - range, d_out = d_base + range;
+	auto const outline_of = [&](convex_closure::hull& h) -> convex_closure::outline {
+		convex_closure::simplify_key_points(h, p.simplify);
+		convex_closure::extend_key_points<true>(h, src_w, src_h, base);
+		return { h, h.LT.x_map };
+	};
+	auto const value = [&](float d) {
+		return static_cast<i16>(std::lround((d - d_base) * distance_unit));
+	};
+
+	if (kind != convex_closure::enclosing_kind::hull) {
+		auto& shape = enclosing_buf;
+		shape.fit(hull, kind, margin, static_cast<float>(base));
+		auto const line = convex_closure::enclosing_rasterizer<1>(shape, plane, dst_w, plane_line, d_in, d_out, value);
+		multi_thread(work_phase::field, dst_w * dst_h, [&](int thread_id, int thread_num) {
+			for (int y = thread_id; y < dst_h; y += thread_num) line(y);
+		});
+		return true;
+	}
+	if (!separate) {
+		convex_closure::rasterize_field<1>(outline_of(hull), plane, dst_w, dst_h, plane_line, margin, d_in, d_out, value);
+		return true;
+	}
+
+	// the nearest of the clusters, by taking the greatest of the negated distances.
+	multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+		for (int y = thread_id; y < dst_h; y += thread_num)
+			std::fill_n(plane + y * plane_line, dst_w, static_cast<i16>(-range * distance_unit));
+	});
+	for (int i = 0; i < parts.size(); i++) {
+		parts.find_key_points(hull, i);
+		convex_closure::rasterize_field<1, write_mode::combine>(outline_of(hull), plane, dst_w, dst_h, plane_line,
+			margin, d_in, d_out, [&](float d) { return static_cast<i16>(-value(d)); });
+	}
+	multi_thread(work_phase::fill, dst_w * dst_h, [&](int thread_id, int thread_num) {
+		for (int y = thread_id; y < dst_h; y += thread_num) {
+			i16* const plane_y = plane + y * plane_line;
+			for (int x = 0; x < dst_w; x++) plane_y[x] = -plane_y[x];
+		}
+	});
+	return true;
+}
+
+void render::compose_batch(batch_item const* items, size_t count)
+{
+	// the same measure as whether a frame goes parallel by itself.
+	int64_t const large = static_cast<int64_t>(multi_thread.cutoff(work_phase::fill)) * multi_thread.num_threads();
+	auto const is_large = [&](batch_item const& it) {
+		int const margin = it.p->margin();
+		return static_cast<int64_t>(it.src_w + 2 * margin) * (it.src_h + 2 * margin) >= large;
+	};
+	auto const draw = [](batch_item const& it) {
+		compose(*it.p, it.src, it.src_w, it.src_h, it.src_line, it.dst, it.dst_line);
+	};
+
+	size_t num_small = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (is_large(items[i])) draw(items[i]);
+		else num_small++;
+	}
+
+	// the threads take the next item one after another, as the sizes may vary.
+	// each thread keeps its own scratch buffers, so nothing is allocated once they have grown enough.
+	std::atomic<size_t> next = 0;
+	multi_thread(num_small < 2, [&](int thread_id, int thread_num) {
+		bool const was_serial = std::exchange(MultiThread::serial, MultiThread::serial || thread_num > 1);
+		for (size_t i; (i = next++) < count;) {
+			if (!is_large(items[i])) draw(items[i]);
+		}
+		MultiThread::serial = was_serial;
+	});
+}
@@ -0,0 +1,107 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "kernels.hpp"
+
+namespace convex_closure { struct hull; }
+
+
+////////////////////////////////
+// フィルタ効果の本体．
+////////////////////////////////
+// the whole drawing of the filter, apart from AviUtl, so other programs can share it.
+namespace render
+{
+	using i16 = kernels::i16;
+	using pixel = kernels::pixel;
+	using kernels::log2_max_alpha, kernels::max_alpha;
+
+	constexpr pixel fromRGB(uint8_t r, uint8_t g, uint8_t b) {
+		// ripped a piece of code from exedit/pixel.hpp.
+		auto r_ = (r << 6) + 18;
+		auto g_ = (g << 6) + 18;
+		auto b_ = (b << 6) + 18;
+		return {
+			static_cast<int16_t>(((r_* 4918)>>16)+((g_* 9655)>>16)+((b_* 1875)>>16)-3),
+			static_cast<int16_t>(((r_*-2775)>>16)+((g_*-5449)>>16)+((b_* 8224)>>16)+1),
+			static_cast<int16_t>(((r_* 8224)>>16)+((g_*-6887)>>16)+((b_*-1337)>>16)+1),
+			max_alpha,
+		};
+	}
+
+	// an image repeated over the plane, whose pixel at (ox, oy) comes to the top-left corner.
+	struct pattern {
+		pixel const* buff;
+		int w, h, ox, oy;
+		size_t line; // pixels per row of `buff`.
+	};
+
+	struct params {
+		int extend, stroke, feather, gap; // in pixels.
+		int alpha, f_alpha; // the opacities of the convex closure and of the original image, up to max_alpha.
+		i16 threshold; // pixels whose alpha exceeds this make up the shape.
+		bool draft, antialias, separate;
+		bool round; // rounds the corners of the margin, as the points within `extend` from the convex closure.
+		int gradient; // 0: single color, 1/2: linear/radial over the object, 3/4: over the convex closure.
+		float angle; // direction of the linear gradient, in degrees.
+		float simplify; // tolerance in pixels to enlarge the polygon for fewer vertices, 0 to keep it exact.
+		// if positive, the alpha is the signed distance from the polygon instead, mapped from [-field, field] in pixels
+		// onto [max_alpha, 0], where the outline and the original image are left out.
+		int field;
+		// if positive, a tighter shape than the convex closure is drawn instead, leaving the dents wider than this
+		// in pixels. `separate` and `simplify` don't apply then.
+		int concave;
+		// 0: the convex closure, 1/2/3: the rectangle, the circle or the ellipse of the least area enclosing it instead,
+		// which `separate`, `simplify` and `concave` don't apply to.
+		int shape;
+		pixel col, col2; // the alpha is ignored.
+		pattern const* img; // used instead of the colors if not null.
+
+		// the size added to each side of the image, where the outer half of the feather fits too.
+		constexpr int margin() const { return extend + (field > 0 ? field : stroke + (feather + 1) / 2); }
+	};
+
+	// draws the convex closure of `src` behind itself into `dst`, which is larger by margin() on each side.
+	// `dst` must be the same as `src` if the margin is zero, and must not overlap it otherwise.
+	// the scratch buffers are kept for each thread, so different frames can be drawn in parallel.
+	// `found` may give the key points of `src` found beforehand, such as by convex_closure::hull_builder
+	// while the image is decoded, in a hull with the heap for the height of `dst`, so `src` isn't scanned again.
+	// they're ignored for `separate` and `concave`, which need the pixels.
+	void compose(params const& p, pixel const* src, int src_w, int src_h, size_t src_line, pixel* dst, size_t dst_line,
+		convex_closure::hull const* found = nullptr);
+
+	// units per pixel of the distance written by distance().
+	constexpr int distance_unit = 16;
+
+	// writes the signed distance from the polygon, negative inside, into the plane of the size larger by margin()
+	// on each side of the image than `src`, `plane_line` i16 per row. the distance is in 1/distance_unit pixels,
+	// clamped to `p.field` pixels. only the parameters of the shape apply, the others are ignored.
+	// returns false leaving `plane` untouched if `p.field` isn't positive or there's no shape.
+	bool distance(params const& p, pixel const* src, int src_w, int src_h, size_t src_line, i16* plane, size_t plane_line);
+
+	// the arguments of compose() for each of compose_batch().
+	struct batch_item {
+		params const* p;
+		pixel const* src; int src_w, src_h; size_t src_line;
+		pixel* dst; size_t dst_line;
+	};
+
+	// draws independent items, such as glyphs, as compose() does for each.
+	// small items are handed to the threads as a whole and drawn on a single thread each,
+	// as they are too small to pay for going parallel inside, while large ones are drawn one by one.
+	void compose_batch(batch_item const* items, size_t count);
+}
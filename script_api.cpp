@@ -0,0 +1,344 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "convex_closure.hpp"
+#include "hull_builder.hpp"
+#include "calibration.hpp"
+#include "render.hpp"
+#include "script_api.hpp"
+
+using namespace convex_closure;
+
+
+////////////////////////////////
+// 凸包の多角形の取得．
+////////////////////////////////
+// lists the vertices of the polygon from the key points found, moved outward by `extend`.
+static int list_polygon(hull& hl, int w, int h, int extend, std::vector<int>& pts, ConvexClosureInfo* info)
+{
+	extend_key_points<true>(hl, w, h, extend);
+
+	pts.resize(2 * (hl.LT.count + hl.LB.count + hl.RT.count + hl.RB.count));
+	int const n = polygon(hl, pts.data());
+
+	if (info != nullptr) {
+		// the bounding box, and the area by the shoelace formula.
+		info->left = info->right = pts[0];
+		info->top = info->bottom = pts[1];
+		int64_t area2 = 0;
+		for (int i = 0, j = n - 1; i < n; j = i++) {
+			int const x = pts[2 * i], y = pts[2 * i + 1];
+			info->left = std::min(info->left, x); info->right = std::max(info->right, x);
+			info->top = std::min(info->top, y); info->bottom = std::max(info->bottom, y);
+			area2 += int64_t{ pts[2 * j] } * y - int64_t{ x } * pts[2 * j + 1];
+		}
+		info->area = std::abs(area2) / 2.0;
+	}
+	return n;
+}
+
+template<size_t src_step, class src_t>
+static int calc_polygon(src_t const* src_buf, int w, int h, size_t src_stride,
+	std::type_identity_t<src_t> threshold, int extend, std::vector<int>& pts, ConvexClosureInfo* info)
+{
+	if (w <= 0 || h <= 0) return 0;
+	extend = std::clamp(extend, 0, 500);
+
+	std::vector<int> heap(hull::heap_size(h + 2 * extend) / sizeof(int));
+	hull hl{ heap.data(), h + 2 * extend };
+	if (!find_key_points<src_step>(hl, src_buf, w, h, src_stride, threshold, false)) return 0;
+	return list_polygon(hl, w, h, extend, pts, info);
+}
+
+int32_t __stdcall ConvexClosure_PolygonYCA(void const* pixels, int32_t w, int32_t h, int32_t line,
+	int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info)
+{
+	if (pixels == nullptr || line < w) return 0;
+
+	// alpha is the last of the four i16 values of ExEdit::PixelYCA.
+	std::vector<int> pts;
+	int const n = calc_polygon<4>(static_cast<i16 const*>(pixels) + 3, w, h, 4 * line,
+		static_cast<i16>(std::clamp(threshold, 0, max_alpha)), extend, pts, info);
+	if (points != nullptr)
+		std::copy_n(pts.begin(), 2 * std::clamp(n, 0, std::max(max_points, 0)), points);
+	return n;
+}
+
+int32_t __stdcall ConvexClosure_PolygonA8(void const* alpha, int32_t w, int32_t h, int32_t line,
+	int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info)
+{
+	if (alpha == nullptr || line < w) return 0;
+
+	std::vector<int> pts;
+	int const n = calc_polygon<1>(static_cast<uint8_t const*>(alpha), w, h, line,
+		static_cast<uint8_t>(std::clamp(threshold, 0, 255)), extend, pts, info);
+	if (points != nullptr)
+		std::copy_n(pts.begin(), 2 * std::clamp(n, 0, std::max(max_points, 0)), points);
+	return n;
+}
+
+int32_t __stdcall ConvexClosure_PolygonRGBA8(void const* pixels, int32_t w, int32_t h, int32_t line,
+	int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info)
+{
+	if (pixels == nullptr || line < w) return 0;
+
+	// alpha is the last of the four bytes.
+	std::vector<int> pts;
+	int const n = calc_polygon<4>(static_cast<uint8_t const*>(pixels) + 3, w, h, 4 * line,
+		static_cast<uint8_t>(std::clamp(threshold, 0, 255)), extend, pts, info);
+	if (points != nullptr)
+		std::copy_n(pts.begin(), 2 * std::clamp(n, 0, std::max(max_points, 0)), points);
+	return n;
+}
+
+// the state between ConvexClosure_BeginRows() and ConvexClosure_EndRows().
+struct ConvexClosureRows {
+	int w, h, extend, format, threshold;
+	std::vector<int> heap;
+	hull hl;
+	hull_builder builder;
+
+	ConvexClosureRows(int w, int h, int extend, int format, int threshold)
+		: w{ w }, h{ h }, extend{ extend }, format{ format }, threshold{ threshold }
+		, heap(hull::heap_size(h + 2 * extend) / sizeof(int))
+		, hl{ heap.data(), h + 2 * extend }
+		, builder{ hl, w, h } {}
+};
+
+ConvexClosureRows* __stdcall ConvexClosure_BeginRows(int32_t w, int32_t h, int32_t format,
+	int32_t threshold, int32_t extend)
+{
+	if (w <= 0 || h <= 0) return nullptr;
+	switch (format) {
+	case ConvexClosureFormat_YCA: threshold = std::clamp(threshold, 0, max_alpha); break;
+	case ConvexClosureFormat_A8:
+	case ConvexClosureFormat_RGBA8: threshold = std::clamp(threshold, 0, 255); break;
+	default: return nullptr;
+	}
+	return new ConvexClosureRows{ w, h, std::clamp(extend, 0, 500), format, threshold };
+}
+
+int32_t __stdcall ConvexClosure_PushRows(ConvexClosureRows* rows, void const* pixels, int32_t count, int32_t line)
+{
+	if (rows == nullptr) return 0;
+	if (pixels == nullptr || count <= 0 || line < rows->w) return rows->builder.lines();
+
+	auto& b = rows->builder;
+	switch (rows->format) {
+	case ConvexClosureFormat_YCA:
+		b.add_lines<4>(static_cast<i16 const*>(pixels) + 3, count, 4 * line, static_cast<i16>(rows->threshold));
+		break;
+	case ConvexClosureFormat_A8:
+		b.add_lines<1>(static_cast<uint8_t const*>(pixels), count, line, static_cast<uint8_t>(rows->threshold));
+		break;
+	case ConvexClosureFormat_RGBA8:
+		b.add_lines<4>(static_cast<uint8_t const*>(pixels) + 3, count, 4 * line, static_cast<uint8_t>(rows->threshold));
+		break;
+	}
+	return b.lines();
+}
+
+int32_t __stdcall ConvexClosure_EndRows(ConvexClosureRows* rows, int32_t* points, int32_t max_points, ConvexClosureInfo* info)
+{
+	if (rows == nullptr) return 0;
+
+	std::vector<int> pts;
+	int const n = rows->builder.finish() ?
+		list_polygon(rows->hl, rows->w, rows->h, rows->extend, pts, info) : 0;
+	delete rows;
+	if (points != nullptr)
+		std::copy_n(pts.begin(), 2 * std::clamp(n, 0, std::max(max_points, 0)), points);
+	return n;
+}
+
+void __stdcall ConvexClosure_Calibrate()
+{
+	calibration::run();
+}
+
+
+////////////////////////////////
+// 複数のオブジェクトの描画．
+////////////////////////////////
+int32_t __stdcall ConvexClosure_DrawBatchYCA(ConvexClosureDrawItem const* items, int32_t count)
+{
+	if (items == nullptr || count <= 0) return 0;
+	calibration::ensure();
+
+	std::vector<render::params> params; params.reserve(count);
+	std::vector<render::batch_item> batch; batch.reserve(count);
+	for (auto const& it : std::span{ items, static_cast<size_t>(count) }) {
+		int const extend = std::clamp(it.extend, 0, 500), stroke = std::clamp(it.stroke, 0, 500),
+			feather = std::clamp(it.feather, 0, 500), margin = extend + stroke + (feather + 1) / 2;
+		if (it.src == nullptr || it.dst == nullptr || it.w <= 0 || it.h <= 0 ||
+			it.src_line < it.w || it.dst_line < it.w + 2 * margin || (margin == 0 && it.src != it.dst)) continue;
+
+		params.push_back({
+			.extend = extend, .stroke = stroke, .feather = feather, .gap = 0,
+			.alpha = std::clamp(it.alpha, 0, max_alpha), .f_alpha = std::clamp(it.f_alpha, 0, max_alpha),
+			.threshold = static_cast<i16>(std::clamp(it.threshold, 0, max_alpha)),
+			.draft = false, .antialias = (it.flags & ConvexClosureDraw_Antialias) != 0, .separate = false,
+			.round = (it.flags & ConvexClosureDraw_Round) != 0,
+			.gradient = 0, .angle = 0, .simplify = 0, .field = 0, .concave = 0, .shape = 0,
+			.col = render::fromRGB(static_cast<uint8_t>(it.color >> 16), static_cast<uint8_t>(it.color >> 8), static_cast<uint8_t>(it.color)),
+			.col2 = {}, .img = nullptr,
+		});
+		batch.push_back({
+			&params.back(),
+			static_cast<render::pixel const*>(it.src), it.w, it.h, static_cast<size_t>(it.src_line),
+			static_cast<render::pixel*>(it.dst), static_cast<size_t>(it.dst_line),
+		});
+	}
+	render::compose_batch(batch.data(), batch.size());
+	return static_cast<int32_t>(batch.size());
+}
+
+int32_t __stdcall ConvexClosure_DistanceYCA(void const* pixels, int32_t w, int32_t h, int32_t line,
+	int32_t threshold, int32_t extend, int32_t range, int32_t flags, int16_t* plane, int32_t plane_line)
+{
+	extend = std::clamp(extend, 0, 500); range = std::clamp(range, 0, 500);
+	if (pixels == nullptr || plane == nullptr || w <= 0 || h <= 0 || line < w ||
+		range <= 0 || plane_line < w + 2 * (extend + range)) return 0;
+	calibration::ensure();
+
+	render::params const p{
+		.extend = extend, .threshold = static_cast<i16>(std::clamp(threshold, 0, max_alpha)),
+		.round = (flags & ConvexClosureDraw_Round) != 0, .field = range,
+	};
+	return render::distance(p, static_cast<render::pixel const*>(pixels), w, h, line, plane, plane_line) ? 1 : 0;
+}
+
+
+////////////////////////////////
+// Lua からの呼び出し．
+////////////////////////////////
+// functions of the Lua API are looked up at runtime from lua51.dll loaded by ExEdit.
+namespace lua
+{
+	using Number = double;
+	using Integer = ptrdiff_t;
+	using CFunction = int(__cdecl*)(lua_State*);
+	constexpr int TNIL = 0;
+
+	inline constinit struct {
+		int		(__cdecl* type)(lua_State* L, int idx) = nullptr;
+		void*	(__cdecl* touserdata)(lua_State* L, int idx) = nullptr;
+		Integer	(__cdecl* tointeger)(lua_State* L, int idx) = nullptr;
+		Number	(__cdecl* tonumber)(lua_State* L, int idx) = nullptr;
+		void	(__cdecl* pushnil)(lua_State* L) = nullptr;
+		void	(__cdecl* pushnumber)(lua_State* L, Number n) = nullptr;
+		void	(__cdecl* pushinteger)(lua_State* L, Integer n) = nullptr;
+		void	(__cdecl* createtable)(lua_State* L, int narr, int nrec) = nullptr;
+		void	(__cdecl* rawseti)(lua_State* L, int idx, int n) = nullptr;
+		void	(__cdecl* setfield)(lua_State* L, int idx, char const* k) = nullptr;
+		void	(__cdecl* pushcclosure)(lua_State* L, CFunction fn, int n) = nullptr;
+		int		(__cdecl* error)(lua_State* L, char const* fmt, ...) = nullptr;
+
+		bool init() {
+			if (error != nullptr) return true;
+			auto const mod = ::GetModuleHandleW(L"lua51.dll");
+			if (mod == nullptr) return false;
+
+			auto pick = [mod]<class T>(T& fn, char const* name) {
+				fn = reinterpret_cast<T>(::GetProcAddress(mod, name));
+				return fn != nullptr;
+			};
+			return
+				pick(type,			"lua_type")			&&
+				pick(touserdata,	"lua_touserdata")	&&
+				pick(tointeger,		"lua_tointeger")	&&
+				pick(tonumber,		"lua_tonumber")		&&
+				pick(pushnil,		"lua_pushnil")		&&
+				pick(pushnumber,	"lua_pushnumber")	&&
+				pick(pushinteger,	"lua_pushinteger")	&&
+				pick(createtable,	"lua_createtable")	&&
+				pick(rawseti,		"lua_rawseti")		&&
+				pick(setfield,		"lua_setfield")		&&
+				pick(pushcclosure,	"lua_pushcclosure")	&&
+				pick(error,			"luaL_error"); // picked last to mark the completion.
+		}
+	} api{};
+}
+
+// polygon(data, w, h [, threshold [, extend]])
+//	data, w, h: return values of obj.getpixeldata().
+//	threshold: αしきい値 in percent, 50 by default.
+//	extend: 余白 in pixels, 0 by default.
+// returns { x1, y1, x2, y2, ... }, area, left, top, right, bottom,
+// or nil if there are no pixels exceeding the threshold.
+static int __cdecl lua_polygon(lua_State* L)
+{
+	auto& api = lua::api;
+	auto const data = static_cast<uint8_t const*>(api.touserdata(L, 1));
+	int const w = static_cast<int>(api.tointeger(L, 2)), h = static_cast<int>(api.tointeger(L, 3));
+	if (data == nullptr || w <= 0 || h <= 0) return api.error(L, "invalid image data.");
+
+	double const threshold = api.type(L, 4) > lua::TNIL ? api.tonumber(L, 4) : 50.0;
+	int const extend = api.type(L, 5) > lua::TNIL ? static_cast<int>(api.tointeger(L, 5)) : 0;
+
+	// pixels of obj.getpixeldata() are of BGRA, 8 bits each.
+	std::vector<int> pts;
+	ConvexClosureInfo info;
+	int const n = calc_polygon<4>(data + 3, w, h, 4 * w,
+		static_cast<uint8_t>(std::clamp(threshold, 0.0, 100.0) * 255 / 100), extend, pts, &info);
+	if (n <= 0) {
+		api.pushnil(L);
+		return 1;
+	}
+
+	api.createtable(L, 2 * n, 0);
+	for (int i = 0; i < 2 * n; i++) {
+		api.pushinteger(L, pts[i]);
+		api.rawseti(L, -2, i + 1);
+	}
+	api.pushnumber(L, info.area);
+	api.pushinteger(L, info.left);
+	api.pushinteger(L, info.top);
+	api.pushinteger(L, info.right);
+	api.pushinteger(L, info.bottom);
+	return 6;
+}
+
+// calibrate()
+// measures and saves the amounts of work worth running in parallel.
+static int __cdecl lua_calibrate(lua_State*)
+{
+	calibration::run();
+	return 0;
+}
+
+// returns nothing, which makes nil for the caller, if the functions of lua51.dll aren't found,
+// and tells it to the debugger as there's no way to raise a Lua error.
+int __cdecl luaopen_ConvexClosure_S(lua_State* L)
+{
+	if (!lua::api.init()) {
+		::OutputDebugStringA("ConvexClosure_S: lua51.dll is not found in the process, so the Lua functions are unavailable.\n");
+		return 0;
+	}
+
+	lua::api.createtable(L, 0, 2);
+	lua::api.pushcclosure(L, &lua_polygon, 0);
+	lua::api.setfield(L, -2, "polygon");
+	lua::api.pushcclosure(L, &lua_calibrate, 0);
+	lua::api.setfield(L, -2, "calibrate");
+	return 1;
+}
@@ -0,0 +1,107 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+////////////////////////////////
+// 外部からの呼び出し．
+////////////////////////////////
+// other plugins may obtain these functions by ::GetProcAddress() on `ConvexClosure_S.eef`,
+// and Lua scripts by package.loadlib().
+struct lua_State;
+extern "C" {
+	struct ConvexClosureInfo {
+		// bounding box of the polygon. right and bottom are exclusive.
+		int32_t left, top, right, bottom;
+		// area of the polygon in pixels.
+		double area;
+	};
+
+	// calculates the convex closure of the pixels whose alpha exceeds `threshold` (0 to 4096),
+	// in the image of ExEdit::PixelYCA that has `line` pixels per row.
+	// the polygon is moved outward by `extend` pixels (up to 500), and its vertices are stored into `points`
+	// as pairs of x and y, up to `max_points` vertices. `info` can be null.
+	// returns the number of the vertices, which is 0 if there are no such pixels.
+	int32_t __stdcall ConvexClosure_PolygonYCA(void const* pixels, int32_t w, int32_t h, int32_t line,
+		int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info);
+
+	// the same as ConvexClosure_PolygonYCA() for 8-bit alpha with `threshold` from 0 to 255,
+	// packed one byte per pixel and `line` bytes per row, without converting the image.
+	int32_t __stdcall ConvexClosure_PolygonA8(void const* alpha, int32_t w, int32_t h, int32_t line,
+		int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info);
+
+	// the same for RGBA or BGRA, 8 bits each with the alpha last, and `line` pixels per row.
+	int32_t __stdcall ConvexClosure_PolygonRGBA8(void const* pixels, int32_t w, int32_t h, int32_t line,
+		int32_t threshold, int32_t extend, int32_t* points, int32_t max_points, ConvexClosureInfo* info);
+
+	// calculates the same polygon as ConvexClosure_Polygon*() from the rows of the image given in order from the top,
+	// so that it's ready as soon as the last row is decoded, without keeping the whole image.
+	// `format` decides the pixels and the range of `threshold` as the functions above.
+	// returns null if `w`, `h` or `format` is invalid.
+	struct ConvexClosureRows;
+	enum : int32_t {
+		ConvexClosureFormat_YCA,
+		ConvexClosureFormat_A8,
+		ConvexClosureFormat_RGBA8,
+	};
+	ConvexClosureRows* __stdcall ConvexClosure_BeginRows(int32_t w, int32_t h, int32_t format,
+		int32_t threshold, int32_t extend);
+
+	// takes the next `count` rows of `pixels`, `line` pixels per row (or bytes for ConvexClosureFormat_A8).
+	// rows beyond `h` are ignored. returns the number of the rows taken so far.
+	int32_t __stdcall ConvexClosure_PushRows(ConvexClosureRows* rows, void const* pixels, int32_t count, int32_t line);
+
+	// stores the polygon as ConvexClosure_Polygon*() do, treating the rows not pushed as transparent,
+	// and frees `rows`.
+	int32_t __stdcall ConvexClosure_EndRows(ConvexClosureRows* rows, int32_t* points, int32_t max_points, ConvexClosureInfo* info);
+
+	// an object for ConvexClosure_DrawBatchYCA(), in ExEdit::PixelYCA with `*_line` pixels per row.
+	// `dst` is larger than `src` by `extend + stroke + (feather + 1) / 2` on each side,
+	// and must be the same as `src` if that's zero.
+	struct ConvexClosureDrawItem {
+		void const* src; int32_t w, h, src_line;
+		void* dst; int32_t dst_line;
+		int32_t extend, stroke, feather; // in pixels.
+		int32_t alpha, f_alpha; // opacities of the convex closure and of the original image, 0 to 4096.
+		int32_t threshold; // 0 to 4096.
+		int32_t color; // 0xRRGGBB.
+		int32_t flags; // ConvexClosureDraw_* combined.
+	};
+	enum : int32_t {
+		ConvexClosureDraw_Antialias = 1 << 0,
+		ConvexClosureDraw_Round = 1 << 1,
+	};
+
+	// draws the convex closure behind each of `count` objects as the filter does, in a single color.
+	// the objects are spread over the threads as a whole, which suits many small ones such as glyphs
+	// better than drawing them one by one. items with invalid sizes or buffers are skipped.
+	// returns the number of the items drawn.
+	int32_t __stdcall ConvexClosure_DrawBatchYCA(ConvexClosureDrawItem const* items, int32_t count);
+
+	// writes the signed distance from the convex closure of the pixels whose alpha exceeds `threshold` (0 to 4096),
+	// extended by `extend` pixels, into `plane` that is larger than the image by `extend + range` on each side
+	// and has `plane_line` values per row. the distance is in 1/16 pixels, negative inside, and clamped to `range`.
+	// ConvexClosureDraw_Round in `flags` rounds the corners of the extended polygon.
+	// returns 1 if written, or 0 if there are no such pixels.
+	int32_t __stdcall ConvexClosure_DistanceYCA(void const* pixels, int32_t w, int32_t h, int32_t line,
+		int32_t threshold, int32_t extend, int32_t range, int32_t flags, int16_t* plane, int32_t plane_line);
+
+	// measures the amounts of work worth running in parallel on this machine,
+	// and saves them to `ConvexClosure_S.ini` next to the plugin. takes a fraction of a second.
+	void __stdcall ConvexClosure_Calibrate();
+
+	// returns a table of the functions for Lua.
+	int __cdecl luaopen_ConvexClosure_S(lua_State* L);
+}
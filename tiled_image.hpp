@@ -25,10 +25,12 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 ////////////////////////////////
 struct tiled_image {
 	int w = 0, h = 0, ox = 0, oy = 0;
+	size_t line = 0; // pixels per row, as loaded by ExEdit.
 	ExEdit::PixelYCA* buff = nullptr;
 
 	operator bool() const { return buff != nullptr; }
-	tiled_image(char const* path, int img_x, int img_y, int displace, ExEdit::Filter* efp, void* buffer)
+	tiled_image(char const* path, int img_x, int img_y, int displace, size_t line, ExEdit::Filter* efp, void* buffer)
+		: line{ line }
 	{
 		if (path == nullptr || path[0] == '\0') return;
 